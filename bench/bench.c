@@ -0,0 +1,43 @@
+#include "bench.h"
+
+#include <errno.h>
+#include <libgen.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/log.h"
+#include "../src/option_parser.h"
+#include "../src/settings.h"
+
+BENCH_EXTERN(bench_icon);
+BENCH_EXTERN(bench_markup);
+BENCH_EXTERN(bench_menu);
+BENCH_EXTERN(bench_notification);
+BENCH_EXTERN(bench_queues);
+BENCH_EXTERN(bench_rules);
+
+int main(int argc, char *argv[]) {
+        char *prog = realpath(argv[0], NULL);
+        if (!prog) {
+                fprintf(stderr, "Cannot determine actual path of bench executable: %s\n", strerror(errno));
+                exit(1);
+        }
+
+        dunst_log_init(true);
+
+        // use the same settings as the test suite
+        char *config_path = g_strconcat(dirname(prog), "/../test/data/dunstrc.default", NULL);
+        cmdline_load(0, NULL);
+        load_settings(config_path);
+        g_free(config_path);
+
+        RUN_BENCH(bench_icon);
+        RUN_BENCH(bench_markup);
+        RUN_BENCH(bench_menu);
+        RUN_BENCH(bench_notification);
+        RUN_BENCH(bench_queues);
+        RUN_BENCH(bench_rules);
+
+        free(prog);
+}
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -0,0 +1,88 @@
+#ifndef DUNST_BENCH_H
+#define DUNST_BENCH_H
+
+#include <glib.h>
+#include <stdio.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "../src/utils.h"
+
+/**
+ * Declare a benchmark group, which is defined in another file
+ */
+#define BENCH_EXTERN(name) void name(void)
+
+/**
+ * Define a benchmark group
+ */
+#define BENCH(name) void name(void)
+
+/**
+ * Run a benchmark group and print its header
+ */
+#define RUN_BENCH(name) do { \
+        printf("\n* %s\n", #name); \
+        name(); \
+        } while (0)
+
+/**
+ * Print the averaged cost of a single operation
+ *
+ * @param name  The operation, which got measured
+ * @param size  The size of the data set, the operation worked on
+ * @param ops   The amount of times the operation got executed
+ * @param start The timestamp, when the measurement started
+ */
+static inline void bench_report(const char *name, unsigned int size, unsigned int ops, gint64 start)
+{
+        gint64 elapsed = time_monotonic_now() - start;
+
+        printf("%-40s %8u %12.1f ns/op\n", name, size, (double) elapsed * 1000 / ops);
+}
+
+/**
+ * Print the throughput of an operation processing \p size bytes
+ *
+ * @param name  The operation, which got measured
+ * @param size  The amount of bytes, the operation processed each time
+ * @param ops   The amount of times the operation got executed
+ * @param start The timestamp, when the measurement started
+ */
+static inline void bench_report_throughput(const char *name, unsigned int size, unsigned int ops, gint64 start)
+{
+        gint64 elapsed = time_monotonic_now() - start;
+
+        printf("%-40s %8u %12.1f MB/s\n", name, size, (double) size * ops / elapsed);
+}
+
+/**
+ * @returns The bytes currently allocated by malloc, or 0 if unknown
+ */
+static inline size_t bench_heap_used(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+        return mallinfo2().uordblks;
+#else
+        return 0;
+#endif
+}
+
+/**
+ * Print the heap memory an operation allocated on average
+ *
+ * @param name  The operation, which got measured
+ * @param size  The size of the data set, the operation worked on
+ * @param ops   The amount of times the operation got executed
+ * @param start The result of bench_heap_used(), when the measurement started
+ */
+static inline void bench_report_memory(const char *name, unsigned int size, unsigned int ops, size_t start)
+{
+        double used = (double) bench_heap_used() - start;
+
+        printf("%-40s %8u %12.1f B/op\n", name, size, used / ops);
+}
+
+#endif
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
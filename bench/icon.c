@@ -0,0 +1,170 @@
+#include "../src/icon.c"
+
+#include "bench.h"
+
+#include <glib/gstdio.h>
+
+#define OPS 50
+#define LOOKUPS 10000
+
+/* about the size of a full Papirus theme */
+#define THEME_FOLDERS 15
+#define THEME_ICONS 2000
+
+static const int sizes[] = { 48, 256, 1024 };
+
+static cairo_status_t read_from_buf(void *closure, unsigned char *data, unsigned int size)
+{
+        GByteArray *buf = (GByteArray *)closure;
+
+        unsigned int cpy = MIN(size, buf->len);
+        memcpy(data, buf->data, cpy);
+        g_byte_array_remove_range(buf, 0, cpy);
+
+        return CAIRO_STATUS_SUCCESS;
+}
+
+/**
+ * The former conversion via a PNG round trip, kept as reference
+ */
+static cairo_surface_t *pixbuf_to_surface_png(GdkPixbuf *pixbuf)
+{
+        cairo_surface_t *icon_surface = NULL;
+        GByteArray *buffer;
+        char *bufstr;
+        gsize buflen;
+
+        gdk_pixbuf_save_to_buffer(pixbuf, &bufstr, &buflen, "png", NULL, NULL);
+
+        buffer = g_byte_array_new_take((guint8*)bufstr, buflen);
+        icon_surface = cairo_image_surface_create_from_png_stream(read_from_buf, buffer);
+
+        g_byte_array_free(buffer, TRUE);
+
+        return icon_surface;
+}
+
+/**
+ * Create a pixbuf with noise, like a photo would contain
+ */
+static GdkPixbuf *bench_pixbuf(int size, bool has_alpha)
+{
+        GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8, size, size);
+        guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+        int stride = gdk_pixbuf_get_rowstride(pixbuf);
+        int n_channels = gdk_pixbuf_get_n_channels(pixbuf);
+
+        for (int y = 0; y < size; y++)
+                for (int x = 0; x < size * n_channels; x++)
+                        pixels[y * stride + x] = g_random_int_range(0, 256);
+
+        return pixbuf;
+}
+
+/**
+ * The former lookup in the icon_path, which checked every folder
+ * and suffix for each icon, kept as reference
+ */
+static char *icon_path_scan(const char *iconname)
+{
+        char **folders = g_strsplit(settings.icon_path, ":", -1);
+        char *found = NULL;
+
+        for (int i = 0; folders[i] && !found; i++) {
+                for (const char **suf = icon_suffixes; *suf && !found; suf++) {
+                        char *maybe_icon_path = g_strconcat(folders[i], "/", iconname, *suf, NULL);
+                        if (is_readable_file(maybe_icon_path))
+                                found = maybe_icon_path;
+                        else
+                                g_free(maybe_icon_path);
+                }
+        }
+
+        g_strfreev(folders);
+        return found;
+}
+
+static void bench_icon_path(void)
+{
+        char *saved = settings.icon_path;
+        char *root = g_dir_make_tmp("dunst-bench-XXXXXX", NULL);
+        GString *icon_path = g_string_new(NULL);
+        gint64 start;
+
+        for (int f = 0; f < THEME_FOLDERS; f++) {
+                char *folder = g_strdup_printf("%s/%d", root, f);
+                g_mkdir(folder, 0700);
+                for (int i = 0; i < THEME_ICONS; i++) {
+                        char *file = g_strdup_printf("%s/icon-%d-%d%s", folder, f, i, icon_suffixes[i % 3]);
+                        g_file_set_contents(file, "", 0, NULL);
+                        g_free(file);
+                }
+                g_string_append_printf(icon_path, "%s%s", f ? ":" : "", folder);
+                g_free(folder);
+        }
+        settings.icon_path = icon_path->str;
+
+        start = time_monotonic_now();
+        icon_index_setup();
+        bench_report("build icon index", THEME_FOLDERS * THEME_ICONS, 1, start);
+
+        char **names = g_malloc(sizeof(char *) * LOOKUPS);
+        for (int i = 0; i < LOOKUPS; i++)
+                names[i] = g_strdup_printf("icon-%d-%d", i % THEME_FOLDERS, (i * 7919) % THEME_ICONS);
+
+        start = time_monotonic_now();
+        for (int i = 0; i < LOOKUPS; i++)
+                icon_index_lookup(names[i]);
+        bench_report("lookup via index", THEME_FOLDERS * THEME_ICONS, LOOKUPS, start);
+
+        start = time_monotonic_now();
+        for (int i = 0; i < LOOKUPS; i++)
+                g_free(icon_path_scan(names[i]));
+        bench_report("lookup via scan", THEME_FOLDERS * THEME_ICONS, LOOKUPS, start);
+
+        for (int i = 0; i < LOOKUPS; i++)
+                g_free(names[i]);
+        g_free(names);
+        icon_index_teardown();
+
+        for (int f = 0; f < THEME_FOLDERS; f++) {
+                for (int i = 0; i < THEME_ICONS; i++) {
+                        char *file = g_strdup_printf("%s/%d/icon-%d-%d%s", root, f, f, i, icon_suffixes[i % 3]);
+                        remove(file);
+                        g_free(file);
+                }
+                char *folder = g_strdup_printf("%s/%d", root, f);
+                remove(folder);
+                g_free(folder);
+        }
+        remove(root);
+        g_free(root);
+
+        g_string_free(icon_path, TRUE);
+        settings.icon_path = saved;
+}
+
+BENCH(bench_icon)
+{
+        bench_icon_path();
+
+        for (int s = 0; s < G_N_ELEMENTS(sizes); s++) {
+                for (int alpha = 0; alpha < 2; alpha++) {
+                        GdkPixbuf *pixbuf = bench_pixbuf(sizes[s], alpha);
+                        gint64 start;
+
+                        start = time_monotonic_now();
+                        for (int i = 0; i < OPS; i++)
+                                cairo_surface_destroy(pixbuf_to_surface_png(pixbuf));
+                        bench_report(alpha ? "rgba via png" : "rgb via png", sizes[s], OPS, start);
+
+                        start = time_monotonic_now();
+                        for (int i = 0; i < OPS; i++)
+                                cairo_surface_destroy(gdk_pixbuf_to_cairo_surface(pixbuf));
+                        bench_report(alpha ? "rgba direct" : "rgb direct", sizes[s], OPS, start);
+
+                        g_object_unref(pixbuf);
+                }
+        }
+}
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
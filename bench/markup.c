@@ -0,0 +1,93 @@
+#include "../src/markup.c"
+
+#include "bench.h"
+
+#define OPS 2000
+#define BODY_LEN 5000
+
+/**
+ * The former transformation, which ran one pass over the whole string
+ * per replaced pattern, kept as reference
+ */
+static char *markup_transform_passes(char *str, enum markup_mode markup_mode)
+{
+        static const char *quote[][2] = {
+                { "&", "&amp;" }, { "\"", "&quot;" }, { "'", "&apos;" },
+                { "<", "&lt;" }, { ">", "&gt;" },
+        };
+        static const char *br[] = { "<br>", "<br/>", "<br />" };
+
+        if (markup_mode == MARKUP_STRIP || markup_mode == MARKUP_FULL)
+                for (int i = 0; i < G_N_ELEMENTS(br); i++)
+                        str = string_replace_all(br[i], "\n", str);
+
+        if (markup_mode == MARKUP_STRIP)
+                str = markup_strip(str);
+
+        if (markup_mode == MARKUP_NO || markup_mode == MARKUP_STRIP)
+                for (int i = 0; i < G_N_ELEMENTS(quote); i++)
+                        str = string_replace_all(quote[i][0], quote[i][1], str);
+
+        if (markup_mode == MARKUP_FULL) {
+                for (char *match = str; (match = strchr(match, '&')); match++) {
+                        if (!markup_is_entity(match)) {
+                                int pos = match - str;
+                                str = string_replace_at(str, pos, 1, "&amp;");
+                                match = str + pos;
+                        }
+                }
+                markup_strip_a(&str, NULL);
+                markup_strip_img(&str, NULL);
+        }
+
+        if (settings.ignore_newline)
+                str = string_replace_all("\n", " ", str);
+
+        return str;
+}
+
+static void bench_body(const char *name, const char *piece)
+{
+        static const char *modes[] = { NULL, "no", "strip", "full" };
+        GString *body = g_string_new(NULL);
+        char *label;
+        gint64 start;
+
+        while (body->len < BODY_LEN)
+                g_string_append(body, piece);
+        g_string_truncate(body, BODY_LEN);
+
+        for (enum markup_mode mode = MARKUP_NO; mode <= MARKUP_FULL; mode++) {
+                start = time_monotonic_now();
+                for (int i = 0; i < OPS; i++)
+                        g_free(markup_transform(g_strdup(body->str), mode));
+                label = g_strdup_printf("%s, %s, single pass", name, modes[mode]);
+                bench_report_throughput(label, body->len, OPS, start);
+                g_free(label);
+
+                start = time_monotonic_now();
+                for (int i = 0; i < OPS; i++)
+                        g_free(markup_transform_passes(g_strdup(body->str), mode));
+                label = g_strdup_printf("%s, %s, passes", name, modes[mode]);
+                bench_report_throughput(label, body->len, OPS, start);
+                g_free(label);
+        }
+
+        g_string_free(body, TRUE);
+}
+
+BENCH(bench_markup)
+{
+        bool saved = settings.ignore_newline;
+        settings.ignore_newline = true;
+
+        bench_body("plain text",
+                   "The quick brown fox jumps over the lazy dog & the cat.\n");
+        bench_body("rich markup",
+                   "<b>Build</b> of <i>dunst</i> &amp; friends failed<br/>"
+                   "see <a href=\"https://example.org/log\">the log</a> "
+                   "<img alt=\"icon\" src=\"file:///tmp/i.png\"> &#x2714; & more\n");
+
+        settings.ignore_newline = saved;
+}
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
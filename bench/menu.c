@@ -0,0 +1,87 @@
+#include "../src/menu.c"
+
+#include "bench.h"
+
+#include <locale.h>
+#include <regex.h>
+
+#define OPS 2000
+#define BODY_LEN 5000
+
+/**
+ * The former extraction via a POSIX regex, kept as reference
+ */
+static char *extract_urls_regex(const regex_t *regex, const char *to_match)
+{
+        char *urls = NULL;
+        const char *p = to_match;
+        regmatch_t m;
+
+        while (regexec(regex, p, 1, &m, 0) == 0) {
+                char *match = g_strndup(p + m.rm_so, m.rm_eo - m.rm_so);
+                urls = string_append(urls, match, "\n");
+                g_free(match);
+
+                p += m.rm_eo;
+        }
+        return urls;
+}
+
+static void bench_body(const char *name, const regex_t *regex, const char *piece)
+{
+        GString *body = g_string_new(NULL);
+        char *label, *urls, *urls_regex;
+        gint64 start;
+
+        while (body->len < BODY_LEN)
+                g_string_append(body, piece);
+
+        urls = extract_urls(body->str);
+        urls_regex = extract_urls_regex(regex, body->str);
+        if (g_strcmp0(urls, urls_regex) != 0)
+                printf("%s: the extracted URLs differ from the regex\n", name);
+        g_free(urls);
+        g_free(urls_regex);
+
+        start = time_monotonic_now();
+        for (int i = 0; i < OPS; i++)
+                g_free(extract_urls(body->str));
+        label = g_strdup_printf("%s via DFA", name);
+        bench_report_throughput(label, body->len, OPS, start);
+        g_free(label);
+
+        start = time_monotonic_now();
+        for (int i = 0; i < OPS; i++)
+                g_free(extract_urls_regex(regex, body->str));
+        label = g_strdup_printf("%s via regex", name);
+        bench_report_throughput(label, body->len, OPS, start);
+        g_free(label);
+
+        g_string_free(body, TRUE);
+}
+
+BENCH(bench_menu)
+{
+        regex_t regex;
+
+        // dunst runs in the locale of the user
+        setlocale(LC_CTYPE, "");
+
+        regcomp(&regex,
+                "\\b(https?://|ftps?://|news://|mailto:|file://|www\\.)"
+                "[-[:alnum:]_\\@;/?:&=%$.+!*\x27,~#]*"
+                "(\\([-[:alnum:]_\\@;/?:&=%$.+!*\x27,~#]*\\)|[-[:alnum:]_\\@;/?:&=%$+*~])+",
+                REG_EXTENDED | REG_ICASE);
+
+        bench_body("plain text", &regex,
+                   "The quick brown fox jumps over the lazy dog, then it rests. ");
+        bench_body("text with URLs", &regex,
+                   "Build failed, see https://ci.example.org/job/42/log (or "
+                   "www.example.org/wiki/Build_(fix)). Mail mailto:dev@example.org! ");
+        bench_body("URL chars only", &regex,
+                   "foo.bar/baz?x=1&y=2;z#frag,");
+
+        regfree(&regex);
+        setlocale(LC_CTYPE, "C");
+}
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
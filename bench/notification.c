@@ -0,0 +1,143 @@
+#include "../src/notification.c"
+
+#include "bench.h"
+
+#define OPS 2000
+#define HISTORY 200000
+#define SENDERS 50
+
+/**
+ * The former formatting, which replaced the specifiers in place one
+ * after another, kept as reference
+ */
+static char *format_message_replace(const struct notification *n)
+{
+        char *msg = string_replace_all("\\n", "\n", g_strdup(n->format));
+
+        for(char *substr = strchr(msg, '%');
+                  substr && *substr;
+                  substr = strchr(substr, '%')) {
+                switch(substr[1]) {
+                case 'a':
+                        notification_replace_single_field(&msg, &substr, n->appname, MARKUP_NO);
+                        break;
+                case 's':
+                        notification_replace_single_field(&msg, &substr, n->summary, MARKUP_NO);
+                        break;
+                case 'b':
+                        notification_replace_single_field(&msg, &substr, n->body, n->markup);
+                        break;
+                default:
+                        substr++;
+                        break;
+                }
+        }
+
+        return g_strchomp(msg);
+}
+
+static void bench_format(const char *name, struct notification *n, const char *format)
+{
+        char *label;
+        gint64 start;
+
+        n->format = format;
+
+        start = time_monotonic_now();
+        notification_format_compile(format);
+        label = g_strdup_printf("compile %s", name);
+        bench_report(label, strlen(format), 1, start);
+        g_free(label);
+
+        start = time_monotonic_now();
+        for (int i = 0; i < OPS; i++)
+                notification_format_message(n);
+        label = g_strdup_printf("render %s via template", name);
+        bench_report(label, strlen(format), OPS, start);
+        g_free(label);
+
+        start = time_monotonic_now();
+        for (int i = 0; i < OPS; i++)
+                g_free(format_message_replace(n));
+        label = g_strdup_printf("render %s via replace", name);
+        bench_report(label, strlen(format), OPS, start);
+        g_free(label);
+}
+
+/**
+ * Fill the history with notifications from a few chatty senders, whose
+ * appname, icon, category and colors either get interned, as on D-Bus,
+ * or copied for each notification, as before.
+ */
+static void bench_history(bool intern)
+{
+        char *(*copy)(const char *) = intern ? string_intern : g_strdup;
+        GPtrArray *history = g_ptr_array_new_with_free_func((GDestroyNotify) notification_unref);
+        size_t heap = bench_heap_used();
+        gint64 start = time_monotonic_now();
+
+        for (int i = 0; i < HISTORY; i++) {
+                int sender = i % SENDERS;
+                char *appname = g_strdup_printf("org.example.Application%d", sender);
+                char *icon = g_strdup_printf("/usr/share/icons/hicolor/48x48/apps/application-%d.png", sender);
+                struct notification *n = notification_create();
+
+                n->appname = copy(appname);
+                n->icon = copy(icon);
+                n->category = copy(sender % 2 ? "im.received" : "email.arrived");
+                n->colors.fg = copy("#ffffff");
+                n->colors.bg = copy("#285577");
+                n->colors.frame = copy("#aaaaaa");
+                n->summary = g_strdup_printf("Message %d", i);
+                n->body = g_strdup("");
+                n->urgency = URG_NORM;
+                notification_init(n);
+                g_ptr_array_add(history, n);
+
+                g_free(appname);
+                g_free(icon);
+        }
+
+        const char *name = intern ? "history, interned strings" : "history, copied strings";
+        bench_report(name, HISTORY, HISTORY, start);
+        bench_report_memory(name, HISTORY, HISTORY, heap);
+        if (intern)
+                printf("%-40s %8u\n", "interned strings", string_interned_count());
+
+        g_ptr_array_free(history, true);
+}
+
+BENCH(bench_notification)
+{
+        struct notification *n = notification_create();
+        GString *body = g_string_new(NULL);
+        GString *many = g_string_new(NULL);
+        GString *literal = g_string_new(NULL);
+
+        for (int i = 0; i < 20; i++)
+                g_string_append(body, "Some text with <b>markup</b> & an entity. ");
+        for (int i = 0; i < 100; i++)
+                g_string_append(many, "%a: %s %b\\n");
+        for (int i = 0; i < 200; i++)
+                g_string_append(literal, "literal text ");
+        g_string_append(literal, "%b");
+
+        n->appname = g_strdup("bench");
+        n->summary = g_strdup("A summary with 'quotes'");
+        n->body = g_strdup(body->str);
+        n->markup = MARKUP_FULL;
+
+        bench_format("typical", n, "<b>%s</b>\\n%b");
+        bench_format("100 fields", n, many->str);
+        bench_format("long literal", n, literal->str);
+
+        notification_unref(n);
+        g_string_free(body, TRUE);
+        g_string_free(many, TRUE);
+        g_string_free(literal, TRUE);
+        notification_format_teardown();
+
+        bench_history(false);
+        bench_history(true);
+}
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -0,0 +1,120 @@
+#include "../src/queues.c"
+
+#include "bench.h"
+
+#define OPS 500
+#define STATUS_BENCH ((struct dunst_status) {.fullscreen=false, .running=true, .idle=false})
+
+static const unsigned int sizes[] = { 1000, 10000, 100000 };
+
+static struct notification *bench_notification(unsigned int i)
+{
+        struct notification *n = notification_create();
+
+        n->appname = g_strdup("bench");
+        n->summary = g_strdup_printf("summary %u", i);
+        n->body =    g_strdup_printf("body %u", i);
+        n->urgency = i % 3;
+        n->format = "%s\n%b";
+
+        notification_init(n);
+
+        return n;
+}
+
+/**
+ * Fill the queues with size notifications, half of them displayed.
+ *
+ * @return (transfer full) the ids of all inserted notifications
+ */
+static int *bench_fill(unsigned int size)
+{
+        int *ids_inserted = g_malloc(sizeof(int) * size);
+        struct notification **all = g_malloc(sizeof(struct notification *) * size);
+        gint64 start;
+
+        for (unsigned int i = 0; i < size; i++)
+                all[i] = bench_notification(i);
+
+        start = time_monotonic_now();
+        for (unsigned int i = 0; i < size; i++)
+                ids_inserted[i] = queues_notification_insert(all[i]);
+        bench_report("insert into waiting", size, size, start);
+
+        settings.geometry.h = size / 2;
+        start = time_monotonic_now();
+        queues_update(STATUS_BENCH, time_monotonic_now());
+        bench_report("update to half displayed", size, size / 2, start);
+
+        g_free(all);
+        return ids_inserted;
+}
+
+BENCH(bench_queues)
+{
+        struct settings saved = settings;
+
+        settings.stack_duplicates = false;
+        settings.indicate_hidden = false;
+        settings.print_notifications = false;
+        settings.history_length = 20;
+
+        for (int s = 0; s < G_N_ELEMENTS(sizes); s++) {
+                unsigned int size = sizes[s];
+                struct notification *replacements[OPS];
+                gint64 start;
+
+                queues_init();
+                int *ids_inserted = bench_fill(size);
+
+                start = time_monotonic_now();
+                for (int i = 0; i < OPS; i++) {
+                        gint64 now = time_monotonic_now();
+                        queues_update(STATUS_BENCH, now);
+                        queues_get_next_datachange(now, STATUS_BENCH);
+                }
+                bench_report("update without due timers", size, OPS, start);
+
+                for (int i = 0; i < OPS; i++) {
+                        replacements[i] = bench_notification(i);
+                        replacements[i]->id = ids_inserted[(i * 7919) % size];
+                }
+
+                start = time_monotonic_now();
+                for (int i = 0; i < OPS; i++)
+                        queues_notification_insert(replacements[i]);
+                bench_report("replace by id", size, OPS, start);
+
+                settings.stack_duplicates = true;
+                for (int i = 0; i < OPS; i++)
+                        replacements[i] = bench_notification(i);
+                start = time_monotonic_now();
+                for (int i = 0; i < OPS; i++)
+                        queues_notification_insert(replacements[i]);
+                bench_report("insert duplicate", size, OPS, start);
+
+                for (int i = 0; i < OPS; i++)
+                        replacements[i] = bench_notification(size + i);
+                start = time_monotonic_now();
+                for (int i = 0; i < OPS; i++)
+                        queues_notification_insert(replacements[i]);
+                bench_report("insert unique", size, OPS, start);
+                settings.stack_duplicates = false;
+
+                start = time_monotonic_now();
+                for (int i = 0; i < OPS; i++)
+                        queues_notification_close_id(ids_inserted[(i * 7919) % size], REASON_USER);
+                bench_report("close by id", size, OPS, start);
+
+                unsigned int remaining = queues_length_waiting() + queues_length_displayed();
+                start = time_monotonic_now();
+                queues_history_push_all();
+                bench_report("push all to history", size, remaining, start);
+
+                g_free(ids_inserted);
+                queues_teardown();
+        }
+
+        settings = saved;
+}
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -0,0 +1,193 @@
+#include "../src/rules.c"
+
+#include "bench.h"
+
+#define RULES 1000
+#define NOTIFICATIONS 100000
+#define APPS 300
+#define CATEGORIES 20
+#define SENDERS 500
+#define REGEX_RULES 200
+
+/**
+ * The former matching, which called fnmatch() for every filter of every
+ * rule, kept as reference
+ */
+static bool rule_matches_fnmatch(struct rule *r, struct notification *n)
+{
+        return   ( (!r->appname   || (n->appname   && !fnmatch(r->appname,   n->appname, 0)))
+                && (!r->summary   || (n->summary   && !fnmatch(r->summary,   n->summary, 0)))
+                && (!r->body      || (n->body      && !fnmatch(r->body,      n->body, 0)))
+                && (!r->icon      || (n->icon      && !fnmatch(r->icon,      n->icon, 0)))
+                && (!r->category  || (n->category  && !fnmatch(r->category,  n->category, 0)))
+                && (!r->stack_tag || (n->stack_tag && !fnmatch(r->stack_tag, n->stack_tag, 0)))
+                && (r->match_transient == -1 || (r->match_transient == n->transient))
+                && (r->msg_urgency == URG_NONE || r->msg_urgency == n->urgency));
+}
+
+static void rule_apply_all_fnmatch(struct notification *n)
+{
+        for (GSList *iter = rules; iter; iter = iter->next) {
+                struct rule *r = iter->data;
+                if (rule_matches_fnmatch(r, n))
+                        rule_apply(r, n);
+        }
+}
+
+/**
+ * Generate rules as they'd appear in a generated config: mostly exact
+ * appnames, some categories and a few globs on the text.
+ */
+static struct rule *bench_rules_create(void)
+{
+        struct rule *r = g_malloc_n(RULES, sizeof(struct rule));
+
+        for (int i = 0; i < RULES; i++) {
+                rule_init(&r[i]);
+                r[i].timeout = i;
+
+                switch (i % 10) {
+                case 0:
+                        r[i].category = g_strdup_printf("category%d", i % CATEGORIES);
+                        break;
+                case 1:
+                        r[i].appname = g_strdup_printf("app%d*", i % APPS);
+                        break;
+                case 2:
+                        r[i].summary = g_strdup_printf("*error %d*", i);
+                        break;
+                case 3:
+                        r[i].appname = g_strdup_printf("app%d", i % APPS);
+                        r[i].body = g_strdup("*failed*");
+                        break;
+                default:
+                        r[i].appname = g_strdup_printf("app%d", i % APPS);
+                        r[i].msg_urgency = URG_CRIT;
+                        break;
+                }
+                rules = g_slist_append(rules, &r[i]);
+        }
+
+        return r;
+}
+
+static void bench_rules_free(struct rule *r)
+{
+        for (int i = 0; i < RULES; i++) {
+                g_free(r[i].appname);
+                g_free(r[i].summary);
+                g_free(r[i].body);
+                g_free(r[i].category);
+        }
+        g_free(r);
+}
+
+/**
+ * Apply rules with a body regex each, separately and combined into one
+ * alternation, to notifications, whose bodies mostly match none of them
+ */
+static void bench_body_regexes(struct notification **n)
+{
+        struct rule *r = g_malloc_n(REGEX_RULES, sizeof(struct rule));
+        gint64 start;
+
+        for (int i = 0; i < REGEX_RULES; i++) {
+                rule_init(&r[i]);
+                r[i].timeout = i;
+                r[i].body_regex = g_strdup_printf("(?i)step %d (failed|timed out)", i);
+                rules = g_slist_append(rules, &r[i]);
+        }
+
+        for (int combine = 0; combine < 2; combine++) {
+                settings.combine_body_regexes = combine;
+                rules_compile();
+
+                start = time_monotonic_now();
+                for (int i = 0; i < NOTIFICATIONS / 10; i++)
+                        rule_apply_all(n[i]);
+                bench_report(combine ? "apply body regexes combined" : "apply body regexes separately",
+                             REGEX_RULES, NOTIFICATIONS / 10, start);
+        }
+
+        g_slist_free(rules);
+        rules = NULL;
+        for (int i = 0; i < REGEX_RULES; i++) {
+                for (int j = 0; j < RULE_FIELD_COUNT; j++)
+                        g_clear_pointer(&r[i].regexes[j], g_regex_unref);
+                g_free(r[i].body_regex);
+        }
+        g_free(r);
+        settings.combine_body_regexes = false;
+}
+
+BENCH(bench_rules)
+{
+        GSList *saved = rules;
+        struct notification **n = g_malloc_n(NOTIFICATIONS, sizeof(struct notification *));
+        gint64 start;
+
+        rules = NULL;
+        struct rule *r = bench_rules_create();
+
+        /* the senders repeat the same properties, only the text varies */
+        for (int i = 0; i < NOTIFICATIONS; i++) {
+                int sender = i % SENDERS;
+                n[i] = notification_create();
+                n[i]->appname = g_strdup_printf("app%d", sender % (APPS + 50));
+                n[i]->category = g_strdup_printf("category%d", sender % (CATEGORIES * 2));
+                n[i]->summary = g_strdup_printf("Build %d finished", i);
+                n[i]->body = i % 100 ? g_strdup("All steps of the pipeline passed, nothing failed.")
+                                     : g_strdup_printf("Step %d failed", i % REGEX_RULES);
+                n[i]->urgency = sender % 3;
+        }
+
+        start = time_monotonic_now();
+        rules_compile();
+        bench_report("compile rules", RULES, 1, start);
+
+        start = time_monotonic_now();
+        for (int i = 0; i < NOTIFICATIONS; i++)
+                rule_apply_all(n[i]);
+        bench_report("apply compiled rules", RULES, NOTIFICATIONS, start);
+        printf("%-40s %8u %12.1f %%\n", "cache hits", RULE_CACHE_SIZE,
+               100.0 * rule_cache.hits / (rule_cache.hits + rule_cache.misses));
+
+        settings.profile_rules = true;
+        start = time_monotonic_now();
+        for (int i = 0; i < NOTIFICATIONS; i++)
+                rule_apply_all(n[i]);
+        bench_report("apply compiled rules, profiled", RULES, NOTIFICATIONS, start);
+        settings.profile_rules = false;
+
+        start = time_monotonic_now();
+        for (int i = 0; i < NOTIFICATIONS; i++)
+                rule_apply_candidates(n[i], 0);
+        bench_report("apply compiled rules without cache", RULES, NOTIFICATIONS, start);
+
+        for (int i = 0; i < NOTIFICATIONS; i++) {
+                gint64 timeout = n[i]->timeout;
+                n[i]->timeout = -1;
+                rule_apply_all_fnmatch(n[i]);
+                if (n[i]->timeout != timeout)
+                        printf("Notification %d: the compiled rules set timeout %ld instead of %ld\n",
+                               i, timeout, n[i]->timeout);
+        }
+
+        start = time_monotonic_now();
+        for (int i = 0; i < NOTIFICATIONS; i++)
+                rule_apply_all_fnmatch(n[i]);
+        bench_report("apply rules via fnmatch", RULES, NOTIFICATIONS, start);
+
+        g_slist_free(rules);
+        rules = NULL;
+        bench_body_regexes(n);
+
+        for (int i = 0; i < NOTIFICATIONS; i++)
+                notification_unref(n[i]);
+        g_free(n);
+
+        bench_rules_free(r);
+        rules = saved;
+        rules_compile();
+}
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -58,6 +58,10 @@ struct settings defaults = {
  * */
 .startup_notification = false,
 
+/* maximum amount of redraws per second, changes in between get
+ * collected into a single frame (0 for no limit) */
+.max_fps = 60,
+
 /* monitor to display notifications on */
 .monitor = 0,
 
@@ -68,6 +72,9 @@ struct settings defaults = {
 
 .max_icon_size = 0,
 
+/* memory in KiB to keep decoded icons in (0 to disable) */
+.icon_cache_size = 4096,
+
 /* paths to default icons */
 .icon_path = "/usr/share/icons/gnome/16x16/status/:/usr/share/icons/gnome/16x16/devices/",
 
@@ -10,6 +10,7 @@
 #include "log.h"
 #include "notification.h"
 #include "queues.h"
+#include "rules.h"
 #include "settings.h"
 #include "utils.h"
 
@@ -17,6 +18,8 @@
 #define FDN_IFAC "org.freedesktop.Notifications"
 #define FDN_NAME "org.freedesktop.Notifications"
 
+#define DUNST_IFAC "org.dunstproject.cmd0"
+
 GDBusConnection *dbus_conn;
 
 static GDBusNodeInfo *introspection_data = NULL;
@@ -63,6 +66,14 @@ static const char *introspection_xml =
     "            <arg name=\"action_key\" type=\"s\"/>"
     "        </signal>"
     "   </interface>"
+
+    "    <interface name=\""DUNST_IFAC"\">"
+
+    "        <method name=\"GetRuleStats\">"
+    "            <arg direction=\"out\" name=\"total\"           type=\"(ttt)\"/>"
+    "            <arg direction=\"out\" name=\"rules\"           type=\"a(sttt)\"/>"
+    "        </method>"
+    "   </interface>"
     "</node>";
 
 static const char *stack_tag_hints[] = {
@@ -88,6 +99,10 @@ static void on_get_server_information(GDBusConnection *connection,
                                       const gchar *sender,
                                       const GVariant *parameters,
                                       GDBusMethodInvocation *invocation);
+static void on_get_rule_stats(GDBusConnection *connection,
+                              const gchar *sender,
+                              const GVariant *parameters,
+                              GDBusMethodInvocation *invocation);
 static struct raw_image *get_raw_image_from_data_hint(GVariant *icon_data);
 
 void handle_method_call(GDBusConnection *connection,
@@ -114,6 +129,24 @@ void handle_method_call(GDBusConnection *connection,
         }
 }
 
+static void handle_dunst_method_call(GDBusConnection *connection,
+                                     const gchar *sender,
+                                     const gchar *object_path,
+                                     const gchar *interface_name,
+                                     const gchar *method_name,
+                                     GVariant *parameters,
+                                     GDBusMethodInvocation *invocation,
+                                     gpointer user_data)
+{
+        if (STR_EQ(method_name, "GetRuleStats")) {
+                on_get_rule_stats(connection, sender, parameters, invocation);
+        } else {
+                LOG_M("Unknown method name: '%s' (sender: '%s').",
+                      method_name,
+                      sender);
+        }
+}
+
 static void on_get_capabilities(GDBusConnection *connection,
                                 const gchar *sender,
                                 const GVariant *parameters,
@@ -159,7 +192,7 @@ static struct notification *dbus_message_to_notification(const gchar *sender, GV
                         switch (idx) {
                         case 0:
                                 if (g_variant_is_of_type(content, G_VARIANT_TYPE_STRING))
-                                        n->appname = g_variant_dup_string(content, NULL);
+                                        n->appname = string_intern(g_variant_get_string(content, NULL));
                                 break;
                         case 1:
                                 if (g_variant_is_of_type(content, G_VARIANT_TYPE_UINT32))
@@ -167,7 +200,7 @@ static struct notification *dbus_message_to_notification(const gchar *sender, GV
                                 break;
                         case 2:
                                 if (g_variant_is_of_type(content, G_VARIANT_TYPE_STRING))
-                                        n->icon = g_variant_dup_string(content, NULL);
+                                        n->icon = string_intern(g_variant_get_string(content, NULL));
                                 break;
                         case 3:
                                 if (g_variant_is_of_type(content, G_VARIANT_TYPE_STRING))
@@ -192,32 +225,32 @@ static struct notification *dbus_message_to_notification(const gchar *sender, GV
 
                                         dict_value = g_variant_lookup_value(content, "fgcolor", G_VARIANT_TYPE_STRING);
                                         if (dict_value) {
-                                                n->colors.fg = g_variant_dup_string(dict_value, NULL);
+                                                n->colors.fg = string_intern(g_variant_get_string(dict_value, NULL));
                                                 g_variant_unref(dict_value);
                                         }
 
                                         dict_value = g_variant_lookup_value(content, "bgcolor", G_VARIANT_TYPE_STRING);
                                         if (dict_value) {
-                                                n->colors.bg = g_variant_dup_string(dict_value, NULL);
+                                                n->colors.bg = string_intern(g_variant_get_string(dict_value, NULL));
                                                 g_variant_unref(dict_value);
                                         }
 
                                         dict_value = g_variant_lookup_value(content, "frcolor", G_VARIANT_TYPE_STRING);
                                         if (dict_value) {
-                                                n->colors.frame = g_variant_dup_string(dict_value, NULL);
+                                                n->colors.frame = string_intern(g_variant_get_string(dict_value, NULL));
                                                 g_variant_unref(dict_value);
                                         }
 
                                         dict_value = g_variant_lookup_value(content, "category", G_VARIANT_TYPE_STRING);
                                         if (dict_value) {
-                                                n->category = g_variant_dup_string(dict_value, NULL);
+                                                n->category = string_intern(g_variant_get_string(dict_value, NULL));
                                                 g_variant_unref(dict_value);
                                         }
 
                                         dict_value = g_variant_lookup_value(content, "image-path", G_VARIANT_TYPE_STRING);
                                         if (dict_value) {
-                                                g_free(n->icon);
-                                                n->icon = g_variant_dup_string(dict_value, NULL);
+                                                string_release(n->icon);
+                                                n->icon = string_intern(g_variant_get_string(dict_value, NULL));
                                                 g_variant_unref(dict_value);
                                         }
 
@@ -337,6 +370,41 @@ static void on_get_server_information(GDBusConnection *connection,
         g_dbus_connection_flush(connection, NULL, NULL, NULL);
 }
 
+static void on_get_rule_stats(GDBusConnection *connection,
+                              const gchar *sender,
+                              const GVariant *parameters,
+                              GDBusMethodInvocation *invocation)
+{
+        if (!settings.profile_rules) {
+                g_dbus_method_invocation_return_error(invocation,
+                                                      G_DBUS_ERROR,
+                                                      G_DBUS_ERROR_NOT_SUPPORTED,
+                                                      "Rules are only profiled with profile_rules enabled");
+                return;
+        }
+
+        GVariantBuilder *builder = g_variant_builder_new(G_VARIANT_TYPE("a(sttt)"));
+        for (GSList *iter = rules; iter; iter = iter->next) {
+                struct rule *r = iter->data;
+                g_variant_builder_add(builder, "(sttt)",
+                                      r->name ? r->name : "",
+                                      r->stats.evaluations,
+                                      r->stats.matches,
+                                      r->stats.time);
+        }
+
+        struct rule_stats total = rules_get_stats();
+        GVariant *value = g_variant_new("((ttt)a(sttt))",
+                                        total.evaluations,
+                                        total.matches,
+                                        total.time,
+                                        builder);
+        g_clear_pointer(&builder, g_variant_builder_unref);
+        g_dbus_method_invocation_return_value(invocation, value);
+
+        g_dbus_connection_flush(connection, NULL, NULL, NULL);
+}
+
 void signal_notification_closed(struct notification *n, enum reason reason)
 {
         if (!n->dbus_valid) {
@@ -404,6 +472,10 @@ static const GDBusInterfaceVTable interface_vtable = {
         handle_method_call
 };
 
+static const GDBusInterfaceVTable dunst_interface_vtable = {
+        handle_dunst_method_call
+};
+
 static void on_bus_acquired(GDBusConnection *connection,
                             const gchar *name,
                             gpointer user_data)
@@ -423,6 +495,18 @@ static void on_bus_acquired(GDBusConnection *connection,
         if (registration_id == 0) {
                 DIE("Unable to register dbus connection: %s", err->message);
         }
+
+        registration_id = g_dbus_connection_register_object(connection,
+                                                            FDN_PATH,
+                                                            introspection_data->interfaces[1],
+                                                            &dunst_interface_vtable,
+                                                            NULL,
+                                                            NULL,
+                                                            &err);
+
+        if (registration_id == 0) {
+                DIE("Unable to register dbus connection: %s", err->message);
+        }
 }
 
 static void on_name_acquired(GDBusConnection *connection,
@@ -593,6 +677,7 @@ static struct raw_image *get_raw_image_from_data_hint(GVariant *icon_data)
 
         image->data = (guchar *) g_memdup(g_variant_get_data(data_variant),
                                           g_variant_get_size(data_variant));
+        image->checksum = NULL;
         g_variant_unref(data_variant);
 
         return image;
@@ -16,6 +16,7 @@
 #include "markup.h"
 #include "notification.h"
 #include "queues.h"
+#include "utils.h"
 #include "x11/x.h"
 
 struct colored_layout {
@@ -23,12 +24,49 @@ struct colored_layout {
         struct color fg;
         struct color bg;
         struct color frame;
-        char *text;
-        PangoAttrList *attr;
         cairo_surface_t *icon;
         const struct notification *n;
 };
 
+/**
+ * The layout of a notification, which gets reused across draw() calls
+ * as long as the inputs to create it do not change.
+ */
+struct layout_cache {
+        PangoLayout *l;
+        char *text;  /**< text_to_render of the notification before parsing */
+        int width;
+        double dpi;
+        char *font;
+};
+
+static unsigned int layout_cache_hits = 0;
+static unsigned int layout_cache_misses = 0;
+
+/**
+ * The inputs, which have been used to paint a notification into the
+ * backbuffer. If they don't change, the row doesn't get repainted.
+ *
+ * The layout and the icon are referenced, so their addresses cannot
+ * be reused by other objects while they get compared.
+ */
+struct row_state {
+        PangoLayout *l;
+        cairo_surface_t *icon;
+        struct color fg;
+        struct color bg;
+        struct color frame;
+        struct color sep;
+        int y;
+        int h;
+        int corner_radius;
+        bool first;
+        bool last;
+};
+
+static cairo_surface_t *backbuffer = NULL; /**< the content of the window */
+static GArray *rows = NULL;                /**< struct row_state of each row in the backbuffer */
+
 struct window_x11 *win;
 
 PangoFontDescription *pango_fdesc;
@@ -39,6 +77,8 @@ void draw_setup(void)
 
         win = x_win_create();
         pango_fdesc = pango_font_description_from_string(settings.font);
+
+        icon_index_setup();
 }
 
 static struct color hex_to_color(int hexValue)
@@ -139,22 +179,81 @@ static void free_colored_layout(void *data)
 {
         struct colored_layout *cl = data;
         g_object_unref(cl->l);
-        pango_attr_list_unref(cl->attr);
-        g_free(cl->text);
         if (cl->icon) cairo_surface_destroy(cl->icon);
         g_free(cl);
 }
 
+static void layout_cache_free(gpointer data)
+{
+        struct layout_cache *lc = data;
+        g_object_unref(lc->l);
+        g_free(lc->text);
+        g_free(lc->font);
+        g_free(lc);
+}
+
+/**
+ * Get the cached layout of a notification.
+ *
+ * @return (transfer none) the layout, if it has been created
+ *         with the same parameters, otherwise NULL
+ */
+static PangoLayout *layout_cache_lookup(const struct notification *n, int width, double dpi)
+{
+        struct layout_cache *lc = notification_get_render_data(n);
+
+        if (   lc
+            && lc->width == width
+            && lc->dpi == dpi
+            && STR_EQ(lc->font, settings.font)
+            && STR_EQ(lc->text, n->text_to_render)) {
+                layout_cache_hits++;
+                return lc->l;
+        }
+
+        layout_cache_misses++;
+        return NULL;
+}
+
+/**
+ * Remember the layout of a notification for the next draw() calls.
+ *
+ * @param text The text_to_render, which has been used to create the layout
+ */
+static void layout_cache_store(struct notification *n, PangoLayout *l, const char *text, int width, double dpi)
+{
+        struct layout_cache *lc = g_malloc(sizeof(struct layout_cache));
+
+        lc->l = g_object_ref(l);
+        lc->text = g_strdup(text);
+        lc->width = width;
+        lc->dpi = dpi;
+        lc->font = g_strdup(settings.font);
+
+        notification_set_render_data(n, lc, layout_cache_free);
+}
+
+/**
+ * The environment of a single frame. It gets looked up once at the
+ * start of draw(), as finding the active screen may cost several
+ * round trips to the X server.
+ */
+struct frame {
+        struct screen_info *scr;
+        double dpi;
+        int width; /**< the width of the window before shrinking it to the content */
+};
+
 static bool have_dynamic_width(void)
 {
         return (settings.geometry.width_set && settings.geometry.w == 0);
 }
 
-static struct dimensions calculate_dimensions(GSList *layouts)
+static struct dimensions calculate_dimensions(const struct frame *f, GSList *layouts)
 {
         struct dimensions dim = { 0 };
 
-        struct screen_info *scr = get_active_screen();
+        struct screen_info *scr = f->scr;
         if (have_dynamic_width()) {
                 /* dynamic width */
                 dim.w = 0;
@@ -232,12 +331,10 @@ static struct dimensions calculate_dimensions(GSList *layouts)
         return dim;
 }
 
-static PangoLayout *layout_create(cairo_t *c)
+static PangoLayout *layout_create(cairo_t *c, double dpi)
 {
-        struct screen_info *screen = get_active_screen();
-
         PangoContext *context = pango_cairo_create_context(c);
-        pango_cairo_context_set_resolution(context, get_dpi_for_screen(screen));
+        pango_cairo_context_set_resolution(context, dpi);
 
         PangoLayout *layout = pango_layout_new(context);
 
@@ -246,11 +343,14 @@ static PangoLayout *layout_create(cairo_t *c)
         return layout;
 }
 
-static struct colored_layout *layout_init_shared(cairo_t *c, const struct notification *n)
+/**
+ * Apply the settings to the layout.
+ *
+ * As pango ignores setting unchanged values, this does not invalidate
+ * a cached layout.
+ */
+static void layout_setup(PangoLayout *layout, int width)
 {
-        struct colored_layout *cl = g_malloc(sizeof(struct colored_layout));
-        cl->l = layout_create(c);
-
         if (!settings.word_wrap) {
                 PangoEllipsizeMode ellipsize;
                 switch (settings.ellipsize) {
@@ -267,9 +367,22 @@ static struct colored_layout *layout_init_shared(cairo_t *c, const struct notifi
                         LOG_E("Invalid %s enum value in %s:%d", "ellipsize", __FILE__, __LINE__);
                         break;
                 }
-                pango_layout_set_ellipsize(cl->l, ellipsize);
+                pango_layout_set_ellipsize(layout, ellipsize);
         }
 
+        layout_setup_pango(layout, width);
+}
+
+/**
+ * Initialise the colors and the icon of the layout. The pango layout
+ * itself is left to the caller.
+ *
+ * @return the width available for the text or -1 for dynamic width
+ */
+static int layout_init_shared(const struct frame *f, struct colored_layout *cl, const struct notification *n)
+{
+        cl->l = NULL;
+
         if (settings.icon_position != ICON_OFF) {
                 cl->icon = icon_get_for_notification(n);
         } else {
@@ -287,52 +400,67 @@ static struct colored_layout *layout_init_shared(cairo_t *c, const struct notifi
 
         cl->n = n;
 
-        struct dimensions dim = calculate_dimensions(NULL);
-        int width = dim.w;
+        if (have_dynamic_width())
+                return -1;
 
-        if (have_dynamic_width()) {
-                layout_setup_pango(cl->l, -1);
-        } else {
-                width -= 2 * settings.h_padding;
-                width -= 2 * settings.frame_width;
-                if (cl->icon) width -= cairo_image_surface_get_width(cl->icon) + settings.h_padding;
-                layout_setup_pango(cl->l, width);
-        }
+        int width = f->width;
 
-        return cl;
+        width -= 2 * settings.h_padding;
+        width -= 2 * settings.frame_width;
+        if (cl->icon) width -= cairo_image_surface_get_width(cl->icon) + settings.h_padding;
+
+        return width;
 }
 
-static struct colored_layout *layout_derive_xmore(cairo_t *c, const struct notification *n, int qlen)
+static struct colored_layout *layout_derive_xmore(cairo_t *c, const struct frame *f, const struct notification *n, int qlen)
 {
-        struct colored_layout *cl = layout_init_shared(c, n);
-        cl->text = g_strdup_printf("(%d more)", qlen);
-        cl->attr = NULL;
-        pango_layout_set_text(cl->l, cl->text, -1);
+        struct colored_layout *cl = g_malloc(sizeof(struct colored_layout));
+        int width = layout_init_shared(f, cl, n);
+
+        cl->l = layout_create(c, f->dpi);
+        layout_setup(cl->l, width);
+
+        char *text = g_strdup_printf("(%d more)", qlen);
+        pango_layout_set_text(cl->l, text, -1);
+        g_free(text);
+
         return cl;
 }
 
-static struct colored_layout *layout_from_notification(cairo_t *c, struct notification *n)
+static struct colored_layout *layout_from_notification(cairo_t *c, const struct frame *f, struct notification *n)
 {
+        struct colored_layout *cl = g_malloc(sizeof(struct colored_layout));
+        int width = layout_init_shared(f, cl, n);
 
-        struct colored_layout *cl = layout_init_shared(c, n);
-
-        /* markup */
-        GError *err = NULL;
-        pango_parse_markup(n->text_to_render, -1, 0, &(cl->attr), &(cl->text), NULL, &err);
-
-        if (!err) {
-                pango_layout_set_text(cl->l, cl->text, -1);
-                pango_layout_set_attributes(cl->l, cl->attr);
+        PangoLayout *cached = layout_cache_lookup(n, width, f->dpi);
+        if (cached) {
+                cl->l = g_object_ref(cached);
+                layout_setup(cl->l, width);
         } else {
-                /* remove markup and display plain message instead */
-                n->text_to_render = markup_strip(n->text_to_render);
-                cl->text = NULL;
-                cl->attr = NULL;
-                pango_layout_set_text(cl->l, n->text_to_render, -1);
-                if (n->first_render) {
-                        LOG_W("Unable to parse markup: %s", err->message);
+                cl->l = layout_create(c, f->dpi);
+                layout_setup(cl->l, width);
+                layout_cache_store(n, cl->l, n->text_to_render, width, f->dpi);
+
+                /* markup */
+                GError *err = NULL;
+                PangoAttrList *attr = NULL;
+                char *text = NULL;
+                pango_parse_markup(n->text_to_render, -1, 0, &attr, &text, NULL, &err);
+
+                if (!err) {
+                        pango_layout_set_text(cl->l, text, -1);
+                        pango_layout_set_attributes(cl->l, attr);
+                        pango_attr_list_unref(attr);
+                        g_free(text);
+                } else {
+                        /* remove markup and display plain message instead */
+                        n->text_to_render = markup_strip(n->text_to_render);
+                        pango_layout_set_text(cl->l, n->text_to_render, -1);
+                        if (n->first_render) {
+                                LOG_W("Unable to parse markup: %s", err->message);
+                        }
+                        g_error_free(err);
                 }
-                g_error_free(err);
         }
 
 
@@ -344,7 +472,7 @@ static struct colored_layout *layout_from_notification(cairo_t *c, struct notifi
         return cl;
 }
 
-static GSList *create_layouts(cairo_t *c)
+static GSList *create_layouts(cairo_t *c, const struct frame *f)
 {
         GSList *layouts = NULL;
 
@@ -364,13 +492,13 @@ static GSList *create_layouts(cairo_t *c)
                         n->text_to_render = new_ttr;
                 }
                 layouts = g_slist_append(layouts,
-                                layout_from_notification(c, n));
+                                layout_from_notification(c, f, n));
         }
 
         if (xmore_is_needed && settings.geometry.h != 1) {
                 /* append xmore message as new message */
                 layouts = g_slist_append(layouts,
-                        layout_derive_xmore(c, queues_get_head_waiting(), qlen));
+                        layout_derive_xmore(c, f, queues_get_head_waiting(), qlen));
         }
 
         return layouts;
@@ -546,6 +674,85 @@ static void render_content(cairo_t *c, struct colored_layout *cl, int width)
 
 }
 
+/**
+ * Get the offset from the top of a notification to the next one,
+ * including its frame and separator.
+ */
+static int layout_get_advance(struct colored_layout *cl, bool first, bool last)
+{
+        const int cl_h = layout_get_height(cl);
+        int advance = 0;
+
+        /* adding frame */
+        if (first)
+                advance += settings.frame_width;
+
+        if (!last)
+                advance += settings.separator_height;
+
+        if (settings.notification_height <= (2 * settings.padding) + cl_h)
+                advance += cl_h + 2 * settings.padding;
+        else
+                advance += settings.notification_height;
+
+        return advance;
+}
+
+static void row_state_clear(gpointer data)
+{
+        struct row_state *row = data;
+
+        g_object_unref(row->l);
+        if (row->icon)
+                cairo_surface_destroy(row->icon);
+}
+
+static struct row_state row_state_create(struct colored_layout *cl,
+                                         struct colored_layout *cl_next,
+                                         struct dimensions dim,
+                                         bool first,
+                                         bool last)
+{
+        struct row_state row = {
+                .l = g_object_ref(cl->l),
+                .icon = cl->icon ? cairo_surface_reference(cl->icon) : NULL,
+                .fg = cl->fg,
+                .bg = cl->bg,
+                .frame = cl->frame,
+                .sep = { 0 },
+                .y = dim.y,
+                .h = layout_get_advance(cl, first, last) + (last ? settings.frame_width : 0),
+                .corner_radius = dim.corner_radius,
+                .first = first,
+                .last = last,
+        };
+
+        if (!last)
+                row.sep = layout_get_sepcolor(cl, cl_next);
+
+        return row;
+}
+
+static bool color_equal(struct color a, struct color b)
+{
+        return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+static bool row_state_equal(const struct row_state *a, const struct row_state *b)
+{
+        return a->l == b->l
+            && a->icon == b->icon
+            && color_equal(a->fg, b->fg)
+            && color_equal(a->bg, b->bg)
+            && color_equal(a->frame, b->frame)
+            && color_equal(a->sep, b->sep)
+            && a->y == b->y
+            && a->h == b->h
+            && a->corner_radius == b->corner_radius
+            && a->first == b->first
+            && a->last == b->last;
+}
+
 static struct dimensions layout_render(cairo_surface_t *srf,
                                        struct colored_layout *cl,
                                        struct colored_layout *cl_next,
@@ -555,9 +762,6 @@ static struct dimensions layout_render(cairo_surface_t *srf,
 {
         const int cl_h = layout_get_height(cl);
 
-        int h_text = 0;
-        pango_layout_get_pixel_size(cl->l, NULL, &h_text);
-
         int bg_width = 0;
         int bg_height = MAX(settings.notification_height, (2 * settings.padding) + cl_h);
 
@@ -566,18 +770,7 @@ static struct dimensions layout_render(cairo_surface_t *srf,
 
         render_content(c, cl, bg_width);
 
-        /* adding frame */
-        if (first)
-                dim.y += settings.frame_width;
-
-        if (!last)
-                dim.y += settings.separator_height;
-
-
-        if (settings.notification_height <= (2 * settings.padding) + cl_h)
-                dim.y += cl_h + 2 * settings.padding;
-        else
-                dim.y += settings.notification_height;
+        dim.y += layout_get_advance(cl, first, last);
 
         cairo_destroy(c);
         cairo_surface_destroy(content);
@@ -588,9 +781,9 @@ static struct dimensions layout_render(cairo_surface_t *srf,
  * Calculates the position the window should be placed at given its width and
  * height and stores them in \p ret_x and \p ret_y.
  */
-static void calc_window_pos(int width, int height, int *ret_x, int *ret_y)
+static void calc_window_pos(const struct frame *f, int width, int height, int *ret_x, int *ret_y)
 {
-        struct screen_info *scr = get_active_screen();
+        struct screen_info *scr = f->scr;
 
         if (ret_x) {
                 if (settings.geometry.negative_x) {
@@ -609,35 +802,108 @@ static void calc_window_pos(int width, int height, int *ret_x, int *ret_y)
         }
 }
 
+/**
+ * Look up everything about the screen, which the frame depends on.
+ */
+static struct frame frame_create(void)
+{
+        struct frame f = { 0 };
+
+        f.scr = get_active_screen();
+        f.dpi = get_dpi_for_screen(f.scr);
+        f.width = calculate_dimensions(&f, NULL).w;
+
+        return f;
+}
+
+/* see draw.h */
+void draw_invalidate(void)
+{
+        g_clear_pointer(&rows, g_array_unref);
+        g_clear_pointer(&backbuffer, cairo_surface_destroy);
+}
+
 void draw(void)
 {
+        unsigned long round_trips = xctx.round_trips;
+        struct frame f = frame_create();
+
+        GSList *layouts = create_layouts(x_win_get_context(win), &f);
+
+        struct dimensions dim = calculate_dimensions(&f, layouts);
 
-        GSList *layouts = create_layouts(x_win_get_context(win));
+        /* The content of an unmapped window is lost */
+        if (   !x_win_visible(win)
+            || !backbuffer
+            || cairo_image_surface_get_width(backbuffer) != dim.w
+            || cairo_image_surface_get_height(backbuffer) != dim.h)
+                draw_invalidate();
 
-        struct dimensions dim = calculate_dimensions(layouts);
+        bool full = !backbuffer;
+        if (full) {
+                backbuffer = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, dim.w, dim.h);
+                rows = g_array_new(false, false, sizeof(struct row_state));
+                g_array_set_clear_func(rows, row_state_clear);
+        }
 
-        cairo_surface_t *image_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, dim.w, dim.h);
+        cairo_region_t *damage = cairo_region_create();
+        cairo_t *c = cairo_create(backbuffer);
+        cairo_set_operator(c, CAIRO_OPERATOR_CLEAR);
 
         bool first = true;
-        for (GSList *iter = layouts; iter; iter = iter->next) {
+        unsigned int i = 0;
+        for (GSList *iter = layouts; iter; iter = iter->next, i++) {
 
                 struct colored_layout *cl_this = iter->data;
                 struct colored_layout *cl_next = iter->next ? iter->next->data : NULL;
 
-                dim = layout_render(image_surface, cl_this, cl_next, dim, first, !cl_next);
+                struct row_state row = row_state_create(cl_this, cl_next, dim, first, !cl_next);
+
+                if (i < rows->len && row_state_equal(&g_array_index(rows, struct row_state, i), &row)) {
+                        row_state_clear(&row);
+                        dim.y += layout_get_advance(cl_this, first, !cl_next);
+                } else {
+                        cairo_rectangle_int_t area = { 0, row.y, dim.w, row.h };
+
+                        if (!full) {
+                                cairo_rectangle(c, area.x, area.y, area.width, area.height);
+                                cairo_fill(c);
+                        }
+                        dim = layout_render(backbuffer, cl_this, cl_next, dim, first, !cl_next);
+                        cairo_region_union_rectangle(damage, &area);
+
+                        if (i < rows->len) {
+                                row_state_clear(&g_array_index(rows, struct row_state, i));
+                                g_array_index(rows, struct row_state, i) = row;
+                        } else {
+                                g_array_append_val(rows, row);
+                        }
+                }
 
                 first = false;
         }
+        cairo_destroy(c);
+
+        /* drop the states of vanished rows */
+        if (i < rows->len)
+                g_array_remove_range(rows, i, rows->len - i);
 
-        calc_window_pos(dim.w, dim.h, &dim.x, &dim.y);
-        x_display_surface(image_surface, win, &dim);
+        calc_window_pos(&f, dim.w, dim.h, &dim.x, &dim.y);
+        x_display_surface(backbuffer, win, &dim, full ? NULL : damage);
 
-        cairo_surface_destroy(image_surface);
+        cairo_region_destroy(damage);
         g_slist_free_full(layouts, free_colored_layout);
+
+        LOG_D("Frame took %lu X round trips", xctx.round_trips - round_trips);
 }
 
 void draw_deinit(void)
 {
+        draw_invalidate();
+        icon_cache_teardown();
+        icon_index_teardown();
+        LOG_D("Layout cache: %u hits, %u misses", layout_cache_hits, layout_cache_misses);
+
         x_win_destroy(win);
         x_free();
 }
@@ -6,8 +6,19 @@ extern struct window_x11 *win; // Temporary
 
 void draw_setup(void);
 
+/**
+ * Draw the displayed notifications into the window.
+ *
+ * The content is kept in a backbuffer, and only the notifications, which
+ * changed since the last call, get repainted and copied to the window.
+ */
 void draw(void);
 
+/**
+ * Drop the backbuffer, so that the next draw() repaints everything
+ */
+void draw_invalidate(void);
+
 void draw_deinit(void);
 
 #endif
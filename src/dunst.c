@@ -53,29 +53,139 @@ struct dunst_status dunst_status_get(void)
         return status;
 }
 
+/**
+ * A GSource, which dispatches once at a single deadline. The deadline
+ * gets re-armed in place instead of adding a new source per wakeup.
+ */
+struct timer_source {
+        GSource source;
+        gint64 deadline;       /**< armed deadline in time_monotonic_now() time, -1 if disarmed */
+        unsigned int wakeups;  /**< amount of dispatches */
+        unsigned int spurious; /**< amount of dispatches, which found nothing due (see run_datachange()) */
+};
+
+static struct timer_source *timer = NULL; /**< the wakeup for the next datachange */
+static struct timer_source *frame = NULL; /**< the pending frame, armed if a redraw got requested */
+
+static gint64 frame_last = 0;       /**< time of the last run() */
+static unsigned int frames_rendered = 0;  /**< amount of run() calls */
+static unsigned int frames_coalesced = 0; /**< amount of wake_up() calls merged into a pending frame */
+
+/**
+ * Arm the timer to dispatch at the given deadline. An already
+ * armed deadline gets replaced.
+ *
+ * @param ts The timer to arm
+ * @param deadline The time to dispatch in time_monotonic_now() time
+ *                 or -1 to disarm the timer
+ */
+static void timer_source_arm(struct timer_source *ts, gint64 deadline)
+{
+        ts->deadline = deadline;
+
+        if (deadline < 0) {
+                g_source_set_ready_time(&ts->source, -1);
+                return;
+        }
+
+        /* The main loop uses g_get_monotonic_time(), which is not
+         * necessarily the same clock as time_monotonic_now() */
+        gint64 sleep = MAX(deadline - time_monotonic_now(), 0);
+        g_source_set_ready_time(&ts->source, g_get_monotonic_time() + sleep);
+}
+
+static gboolean timer_source_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
+{
+        struct timer_source *ts = (struct timer_source *) source;
+        gint64 early = ts->deadline - time_monotonic_now();
+
+        ts->wakeups++;
+        if (early > 0)
+                LOG_D("Timer: Woken up %"G_GINT64_FORMAT"us before the deadline", early);
+
+        timer_source_arm(ts, -1);
+
+        return callback ? callback(user_data) : G_SOURCE_CONTINUE;
+}
+
+/**
+ * Create a new disarmed timer_source and attach it to the given context
+ *
+ * @param name The name of the timer used in debugging output
+ * @param context The context to attach to (NULL for the default context)
+ * @param callback The function to call, when the deadline is reached
+ */
+static struct timer_source *timer_source_new(const char *name, GMainContext *context, GSourceFunc callback)
+{
+        static GSourceFuncs timer_fn = {
+                NULL,
+                NULL,
+                timer_source_dispatch,
+                NULL
+        };
+
+        struct timer_source *ts = (struct timer_source *) g_source_new(&timer_fn, sizeof(struct timer_source));
+        ts->wakeups = 0;
+        ts->spurious = 0;
+        timer_source_arm(ts, -1);
+
+        g_source_set_name(&ts->source, name);
+        g_source_set_callback(&ts->source, callback, NULL, NULL);
+        g_source_attach(&ts->source, context);
+
+        return ts;
+}
+
+/**
+ * Detach and free the timer
+ */
+static void timer_source_destroy(struct timer_source *ts)
+{
+        LOG_D("Timer %s: %u wakeups, %u spurious",
+              g_source_get_name(&ts->source), ts->wakeups, ts->spurious);
+
+        g_source_destroy(&ts->source);
+        g_source_unref(&ts->source);
+}
+
 /* misc functions */
-static gboolean run(void *data);
+static bool run(void);
 
+/* see dunst.h */
 void wake_up(void)
 {
-        run(NULL);
+        if (frame->deadline >= 0) {
+                frames_coalesced++;
+                return;
+        }
+
+        gint64 interval = settings.max_fps > 0 ? S2US(1) / settings.max_fps : 0;
+        timer_source_arm(frame, MAX(frame_last + interval, time_monotonic_now()));
 }
 
-static gboolean run(void *data)
+/**
+ * Update the queues and the window and re-arm the timers
+ *
+ * @return true, if queues_update() found anything due
+ */
+static bool run(void)
 {
-        static gint64 next_timeout = 0;
-
         LOG_D("RUN");
 
-        dunst_status(S_FULLSCREEN, have_fullscreen_window());
+        frame_last = time_monotonic_now();
+        frames_rendered++;
+        /* Everything requested so far gets drawn now */
+        timer_source_arm(frame, -1);
+
         dunst_status(S_IDLE, x_is_idle());
 
         GQueue *history = get_history_queue();
         bool is_idle = status.fullscreen ? false : status.idle;
         if (is_idle && settings.repopup_on_idle) {
+            unsigned long idle_time = x_get_idle_time();
             while (!g_queue_is_empty(history)) {
                 struct notification *n = g_queue_peek_tail(history);
-                if (x_get_idle_time() > (time_monotonic_now() - n->timestamp) / 1000) {
+                if (idle_time > (time_monotonic_now() - n->timestamp) / 1000) {
                     queues_history_pop_non_sticky();
                 } else {
                     break;
@@ -83,10 +193,13 @@ static gboolean run(void *data)
             }
         }
 
-        queues_update(status);
+        bool changed = queues_update(status, time_monotonic_now());
 
         bool active = queues_length_displayed() > 0;
-        bool should_wakeup_for_idle_check = !status.idle && settings.idle_threshold != 0 && settings.repopup_on_idle;
+        bool should_wakeup_for_idle_check =    !status.idle
+                                            && settings.idle_threshold != 0
+                                            && settings.repopup_on_idle
+                                            && !x_idle_is_tracked();
 
         if (active) {
                 // Call draw before showing the window to avoid flickering
@@ -96,25 +209,43 @@ static gboolean run(void *data)
                 x_win_hide(win);
         }
 
+        gint64 timeout_at = -1;
         if (active || should_wakeup_for_idle_check) {
                 gint64 now = time_monotonic_now();
                 gint64 sleep = queues_get_next_datachange(now, status);
-                gint64 timeout_at = now + sleep;
 
-                if (sleep >= 0) {
-                        if (next_timeout < now || timeout_at < next_timeout) {
-                                g_timeout_add(sleep/1000, run, NULL);
-                                next_timeout = timeout_at;
-                        }
-                }
+                if (sleep >= 0)
+                        timeout_at = now + sleep;
         }
+        timer_source_arm(timer, timeout_at);
+
+        return changed;
+}
 
-        /* If the execution got triggered by g_timeout_add,
-         * we have to remove the timeout (which is actually a
-         * recurring interval), as we have set a new one
-         * by ourselves.
-         */
-        return G_SOURCE_REMOVE;
+/**
+ * Callback of the datachange timer. It's armed for
+ * queues_get_next_datachange(), so a pass without anything due was a
+ * spurious wakeup. Polling for the idle state (without X idle alarms)
+ * counts as such, too.
+ */
+static gboolean run_datachange(void *data)
+{
+        if (!run())
+                timer->spurious++;
+
+        return G_SOURCE_CONTINUE;
+}
+
+/**
+ * Callback of the frame timer
+ */
+static gboolean run_timeout(void *data)
+{
+        run();
+
+        /* The timers are persistent, run() has re-armed them
+         * by itself, if necessary. */
+        return G_SOURCE_CONTINUE;
 }
 
 gboolean pause_signal(gpointer data)
@@ -142,9 +273,8 @@ gboolean quit_signal(gpointer data)
 
 static void teardown(void)
 {
-        regex_teardown();
-
         queues_teardown();
+        notification_format_teardown();
 
         draw_deinit();
 }
@@ -184,6 +314,8 @@ int dunst_main(int argc, char *argv[])
         int dbus_owner_id = dbus_init();
 
         mainloop = g_main_loop_new(NULL, FALSE);
+        timer = timer_source_new("datachange", NULL, run_datachange);
+        frame = timer_source_new("frame", NULL, run_timeout);
 
         draw_setup();
 
@@ -198,7 +330,7 @@ int dunst_main(int argc, char *argv[])
         if (settings.startup_notification) {
                 struct notification *n = notification_create();
                 n->id = 0;
-                n->appname = g_strdup("dunst");
+                n->appname = string_intern("dunst");
                 n->summary = g_strdup("startup");
                 n->body = g_strdup("dunst is up and running");
                 n->progress = -1;
@@ -210,7 +342,7 @@ int dunst_main(int argc, char *argv[])
                 // we do not call wakeup now, wake_up does not work here yet
         }
 
-        run(NULL);
+        run();
         g_main_loop_run(mainloop);
         g_clear_pointer(&mainloop, g_main_loop_unref);
 
@@ -219,6 +351,9 @@ int dunst_main(int argc, char *argv[])
         g_source_remove(unpause_src);
         g_source_remove(term_src);
         g_source_remove(int_src);
+        g_clear_pointer(&timer, timer_source_destroy);
+        g_clear_pointer(&frame, timer_source_destroy);
+        LOG_D("Frames: %u rendered, %u coalesced", frames_rendered, frames_coalesced);
 
         dbus_teardown(dbus_owner_id);
 
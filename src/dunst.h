@@ -33,6 +33,13 @@ void dunst_status(const enum dunst_status_field field,
 
 struct dunst_status dunst_status_get(void);
 
+/**
+ * Request to synchronize the queues with the UI.
+ *
+ * The update is not done immediately, but in the next frame, so that
+ * multiple requests in a short time get coalesced into a single redraw.
+ * The frame rate is limited by settings.max_fps.
+ */
 void wake_up(void);
 
 int dunst_main(int argc, char *argv[]);
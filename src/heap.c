@@ -0,0 +1,176 @@
+/* copyright 2013 Sascha Kruse and contributors (see LICENSE for licensing information) */
+
+#include "heap.h"
+
+#include <assert.h>
+#include <glib.h>
+
+struct heap {
+        GPtrArray *nodes;
+        GCompareFunc cmp;
+        guint64 seq;
+};
+
+/* see heap.h */
+struct heap *heap_new(GCompareFunc cmp)
+{
+        struct heap *h = g_malloc(sizeof(struct heap));
+
+        h->nodes = g_ptr_array_new();
+        h->cmp = cmp;
+        h->seq = 0;
+
+        return h;
+}
+
+/* see heap.h */
+void heap_free(struct heap *h, GDestroyNotify free_data)
+{
+        if (!h)
+                return;
+
+        for (unsigned int i = 0; i < h->nodes->len; i++) {
+                struct heap_node *node = g_ptr_array_index(h->nodes, i);
+                if (free_data)
+                        free_data(node->data);
+                g_free(node);
+        }
+
+        g_ptr_array_free(h->nodes, TRUE);
+        g_free(h);
+}
+
+/* see heap.h */
+int heap_node_cmp(const struct heap *h, const struct heap_node *a, const struct heap_node *b)
+{
+        int cmp = h->cmp(a->data, b->data);
+
+        if (cmp != 0)
+                return cmp;
+
+        return a->seq > b->seq ? -1 : 1;
+}
+
+/**
+ * Put a node at the given position
+ */
+static void heap_set(struct heap *h, unsigned int pos, struct heap_node *node)
+{
+        g_ptr_array_index(h->nodes, pos) = node;
+        node->pos = pos;
+}
+
+/**
+ * Move a node towards the top until its parent is in front of it
+ */
+static void heap_sift_up(struct heap *h, struct heap_node *node)
+{
+        unsigned int pos = node->pos;
+
+        while (pos > 0) {
+                unsigned int parent = (pos - 1) / 2;
+                struct heap_node *p = g_ptr_array_index(h->nodes, parent);
+
+                if (heap_node_cmp(h, node, p) > 0)
+                        break;
+
+                heap_set(h, pos, p);
+                pos = parent;
+        }
+
+        heap_set(h, pos, node);
+}
+
+/**
+ * Move a node towards the bottom until both children are behind it
+ */
+static void heap_sift_down(struct heap *h, struct heap_node *node)
+{
+        unsigned int pos = node->pos;
+
+        while (2 * pos + 1 < h->nodes->len) {
+                unsigned int child = 2 * pos + 1;
+                struct heap_node *c = g_ptr_array_index(h->nodes, child);
+
+                if (child + 1 < h->nodes->len) {
+                        struct heap_node *sibling = g_ptr_array_index(h->nodes, child + 1);
+                        if (heap_node_cmp(h, sibling, c) < 0) {
+                                c = sibling;
+                                child++;
+                        }
+                }
+
+                if (heap_node_cmp(h, node, c) < 0)
+                        break;
+
+                heap_set(h, pos, c);
+                pos = child;
+        }
+
+        heap_set(h, pos, node);
+}
+
+/* see heap.h */
+struct heap_node *heap_push(struct heap *h, gpointer data)
+{
+        struct heap_node *node = g_malloc(sizeof(struct heap_node));
+
+        node->data = data;
+        node->seq = h->seq++;
+        node->pos = h->nodes->len;
+
+        g_ptr_array_add(h->nodes, node);
+        heap_sift_up(h, node);
+
+        return node;
+}
+
+/* see heap.h */
+struct heap_node *heap_peek(const struct heap *h)
+{
+        if (h->nodes->len == 0)
+                return NULL;
+
+        return g_ptr_array_index(h->nodes, 0);
+}
+
+/* see heap.h */
+gpointer heap_remove(struct heap *h, struct heap_node *node)
+{
+        assert(node->pos < h->nodes->len && g_ptr_array_index(h->nodes, node->pos) == node);
+
+        struct heap_node *last = g_ptr_array_remove_index(h->nodes, h->nodes->len - 1);
+
+        if (last != node) {
+                heap_set(h, node->pos, last);
+                heap_update(h, last);
+        }
+
+        gpointer data = node->data;
+        g_free(node);
+
+        return data;
+}
+
+/* see heap.h */
+void heap_update(struct heap *h, struct heap_node *node)
+{
+        heap_sift_up(h, node);
+        heap_sift_down(h, node);
+}
+
+/* see heap.h */
+unsigned int heap_length(const struct heap *h)
+{
+        return h->nodes->len;
+}
+
+/* see heap.h */
+struct heap_node *heap_nth(const struct heap *h, unsigned int i)
+{
+        assert(i < h->nodes->len);
+
+        return g_ptr_array_index(h->nodes, i);
+}
+
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -0,0 +1,98 @@
+/* copyright 2013 Sascha Kruse and contributors (see LICENSE for licensing information) */
+
+/**
+ * @file src/heap.h
+ * @brief A binary heap with stable handles to its elements
+ */
+
+#ifndef DUNST_HEAP_H
+#define DUNST_HEAP_H
+
+#include <glib.h>
+
+struct heap;
+
+/**
+ * A single element of a heap. The node stays valid until the element gets
+ * removed from the heap, so it can be used to remove or reorder it later on.
+ */
+struct heap_node {
+        gpointer data;     /**< the element itself */
+        unsigned int pos;  /**< current position in the heap, do not modify */
+        guint64 seq;       /**< insertion order to break ties, do not modify */
+};
+
+/**
+ * Create a new empty heap
+ *
+ * @param cmp Compares two elements. The element, which compares lowest is
+ *            on top of the heap. If two elements compare equal, the
+ *            element added later is on top, just as with
+ *            g_queue_insert_sorted().
+ */
+struct heap *heap_new(GCompareFunc cmp);
+
+/**
+ * Free the heap and all of its nodes
+ *
+ * @param h (nullable) The heap to free
+ * @param free_data (nullable) Function to free the elements with
+ */
+void heap_free(struct heap *h, GDestroyNotify free_data);
+
+/**
+ * Add an element to the heap
+ *
+ * @param h The heap
+ * @param data The element to add
+ *
+ * @return the node of the element
+ */
+struct heap_node *heap_push(struct heap *h, gpointer data);
+
+/**
+ * Get the node with the top element of the heap
+ *
+ * @return the top node or NULL, if the heap is empty
+ */
+struct heap_node *heap_peek(const struct heap *h);
+
+/**
+ * Remove a node from the heap and free it
+ *
+ * @param h The heap
+ * @param node The node to remove, it has to be part of the heap
+ *
+ * @return the element of the removed node
+ */
+gpointer heap_remove(struct heap *h, struct heap_node *node);
+
+/**
+ * Restore the heap order after the element of a node changed its
+ * priority or after #heap_node.data got replaced.
+ */
+void heap_update(struct heap *h, struct heap_node *node);
+
+/**
+ * Returns the amount of elements in the heap
+ */
+unsigned int heap_length(const struct heap *h);
+
+/**
+ * Access a node by its position in the heap. This allows to iterate over
+ * all elements, but not in order.
+ *
+ * @param h The heap
+ * @param i The position, it has to be lower than heap_length()
+ */
+struct heap_node *heap_nth(const struct heap *h, unsigned int i);
+
+/**
+ * Compare two nodes in the order of the heap
+ *
+ * @return a negative value, if a is in front of b, else a positive value
+ */
+int heap_node_cmp(const struct heap *h, const struct heap_node *a, const struct heap_node *b);
+
+#endif
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
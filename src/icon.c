@@ -2,51 +2,563 @@
 
 #include <cairo.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gio/gio.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
+#include <sys/stat.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "log.h"
 #include "notification.h"
 #include "settings.h"
 #include "utils.h"
 
+/**
+ * A decoded icon, which is ready to paint
+ */
+struct icon_cache_entry {
+        char *key;                /**< the source of the icon and the target size */
+        cairo_surface_t *surface;
+        gsize size;               /**< memory used by the surface in bytes */
+        char *path;               /**< the file the icon got loaded from, NULL for raw icons */
+        time_t mtime;             /**< modification time of the file at loading */
+        off_t fsize;              /**< size of the file at loading */
+        GList *lru;               /**< the node of the entry in #icon_cache_lru */
+};
+
+static GHashTable *icon_cache = NULL;         /**< key -> struct icon_cache_entry */
+static GQueue icon_cache_lru = G_QUEUE_INIT;  /**< the entries, most recently used first */
+static gsize icon_cache_used = 0;             /**< memory used by all surfaces in bytes */
+
+static unsigned int icon_cache_hits = 0;
+static unsigned int icon_cache_misses = 0;
+static unsigned int icon_cache_evictions = 0;
+
+static const char *icon_suffixes[] = { ".svg", ".png", ".xpm", NULL };
+
+/**
+ * A file in the icon_path, which may get loaded for an icon name
+ */
+struct icon_candidate {
+        char *path;
+        int rank;   /**< precedence of the file, lower is better */
+};
+
+static GHashTable *icon_index = NULL;       /**< icon name -> GQueue of struct icon_candidate sorted by rank */
+static char *icon_index_path = NULL;        /**< the icon_path, which has been indexed */
+static char **icon_index_folders = NULL;    /**< the folders of #icon_index_path */
+static GPtrArray *icon_index_monitors = NULL;
+
 static bool is_readable_file(const char *filename)
 {
         return (access(filename, R_OK) != -1);
 }
 
-static cairo_status_t read_from_buf(void *closure, unsigned char *data, unsigned int size)
+static void icon_candidate_free(gpointer data)
+{
+        struct icon_candidate *c = data;
+        g_free(c->path);
+        g_free(c);
+}
+
+static void icon_candidates_free(gpointer data)
+{
+        g_queue_free_full(data, icon_candidate_free);
+}
+
+static gint icon_candidate_cmp(gconstpointer a, gconstpointer b, gpointer data)
+{
+        return ((const struct icon_candidate *) a)->rank
+             - ((const struct icon_candidate *) b)->rank;
+}
+
+/**
+ * Split a filename into the icon name and its suffix.
+ *
+ * @param filename The basename of a file
+ * @param name (out) (transfer full) The icon name, if the suffix is known
+ * @return the index of the suffix in #icon_suffixes or -1
+ */
+static int icon_split_suffix(const char *filename, char **name)
+{
+        for (int i = 0; icon_suffixes[i]; i++) {
+                if (g_str_has_suffix(filename, icon_suffixes[i])) {
+                        *name = g_strndup(filename, strlen(filename) - strlen(icon_suffixes[i]));
+                        return i;
+                }
+        }
+        return -1;
+}
+
+static void icon_index_add(const char *name, char *path, int rank)
+{
+        struct icon_candidate *c = g_malloc(sizeof(struct icon_candidate));
+        GQueue *candidates = g_hash_table_lookup(icon_index, name);
+
+        if (!candidates) {
+                candidates = g_queue_new();
+                g_hash_table_insert(icon_index, g_strdup(name), candidates);
+        }
+
+        c->path = path;
+        c->rank = rank;
+        g_queue_insert_sorted(candidates, c, icon_candidate_cmp, NULL);
+}
+
+/**
+ * Re-read the files of an icon name in a single folder
+ *
+ * @param folder The index of the folder in #icon_index_folders
+ * @param name The icon name
+ */
+static void icon_index_refresh(int folder, const char *name)
+{
+        GQueue *candidates = g_hash_table_lookup(icon_index, name);
+        int n_suffixes = G_N_ELEMENTS(icon_suffixes) - 1;
+
+        for (GList *iter = candidates ? candidates->head : NULL; iter; ) {
+                struct icon_candidate *c = iter->data;
+                GList *next = iter->next;
+
+                if (c->rank / n_suffixes == folder) {
+                        icon_candidate_free(c);
+                        g_queue_delete_link(candidates, iter);
+                }
+                iter = next;
+        }
+
+        for (int i = 0; icon_suffixes[i]; i++) {
+                char *path = g_strconcat(icon_index_folders[folder], "/", name, icon_suffixes[i], NULL);
+                if (is_readable_file(path))
+                        icon_index_add(name, path, folder * n_suffixes + i);
+                else
+                        g_free(path);
+        }
+
+        candidates = g_hash_table_lookup(icon_index, name);
+        if (candidates && g_queue_is_empty(candidates))
+                g_hash_table_remove(icon_index, name);
+}
+
+static void icon_index_changed(GFileMonitor *monitor,
+                               GFile *file,
+                               GFile *other_file,
+                               GFileMonitorEvent event,
+                               gpointer user_data)
 {
-        GByteArray *buf = (GByteArray *)closure;
+        /* Changed contents get picked up by the icon cache */
+        if (   event == G_FILE_MONITOR_EVENT_CHANGED
+            || event == G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT)
+                return;
+
+        char *basename = g_file_get_basename(file);
+        char *name;
+
+        if (icon_split_suffix(basename, &name) >= 0) {
+                LOG_D("Icon index: '%s' changed", basename);
+                icon_index_refresh(GPOINTER_TO_INT(user_data), name);
+                g_free(name);
+        }
 
-        unsigned int cpy = MIN(size, buf->len);
-        memcpy(data, buf->data, cpy);
-        g_byte_array_remove_range(buf, 0, cpy);
+        g_free(basename);
+}
 
-        return CAIRO_STATUS_SUCCESS;
+/* see icon.h */
+void icon_index_teardown(void)
+{
+        g_clear_pointer(&icon_index_monitors, g_ptr_array_unref);
+        g_clear_pointer(&icon_index, g_hash_table_unref);
+        g_clear_pointer(&icon_index_folders, g_strfreev);
+        g_clear_pointer(&icon_index_path, g_free);
 }
 
+/* see icon.h */
+void icon_index_setup(void)
+{
+        int n_suffixes = G_N_ELEMENTS(icon_suffixes) - 1;
+
+        icon_index_teardown();
+
+        icon_index = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, icon_candidates_free);
+        icon_index_monitors = g_ptr_array_new_with_free_func(g_object_unref);
+        icon_index_path = g_strdup(settings.icon_path);
+        icon_index_folders = g_strsplit(settings.icon_path ? settings.icon_path : "", ":", -1);
+
+        for (int folder = 0; icon_index_folders[folder]; folder++) {
+                const char *filename;
+                GDir *dir = g_dir_open(icon_index_folders[folder], 0, NULL);
+
+                if (!dir)
+                        continue;
+
+                while ((filename = g_dir_read_name(dir))) {
+                        char *name;
+                        int suffix = icon_split_suffix(filename, &name);
+
+                        if (suffix < 0)
+                                continue;
+
+                        icon_index_add(name,
+                                       g_strconcat(icon_index_folders[folder], "/", filename, NULL),
+                                       folder * n_suffixes + suffix);
+                        g_free(name);
+                }
+                g_dir_close(dir);
+
+                GError *err = NULL;
+                GFile *file = g_file_new_for_path(icon_index_folders[folder]);
+                GFileMonitor *monitor = g_file_monitor_directory(file, G_FILE_MONITOR_NONE, NULL, &err);
+
+                if (monitor) {
+                        g_signal_connect(monitor, "changed", G_CALLBACK(icon_index_changed), GINT_TO_POINTER(folder));
+                        g_ptr_array_add(icon_index_monitors, monitor);
+                } else {
+                        LOG_D("Cannot watch icon folder '%s': %s", icon_index_folders[folder], err->message);
+                        g_error_free(err);
+                }
+                g_object_unref(file);
+        }
+
+        LOG_D("Icon index: %u icon names", g_hash_table_size(icon_index));
+}
+
+/**
+ * Get the files, which may be loaded for an icon name
+ *
+ * @return (nullable) (transfer none) the GQueue of struct icon_candidate
+ *         ordered by precedence
+ */
+static GQueue *icon_index_lookup(const char *name)
+{
+        if (!icon_index || g_strcmp0(icon_index_path, settings.icon_path) != 0)
+                icon_index_setup();
+
+        return g_hash_table_lookup(icon_index, name);
+}
+
+static void icon_cache_entry_free(gpointer data)
+{
+        struct icon_cache_entry *e = data;
+
+        cairo_surface_destroy(e->surface);
+        g_free(e->key);
+        g_free(e->path);
+        g_free(e);
+}
+
+static void icon_cache_remove(struct icon_cache_entry *e)
+{
+        icon_cache_used -= e->size;
+        g_queue_delete_link(&icon_cache_lru, e->lru);
+        g_hash_table_remove(icon_cache, e->key);
+}
+
+/**
+ * Remove the least recently used entries, until the used memory
+ * fits into limit.
+ */
+static void icon_cache_evict(gsize limit)
+{
+        while (icon_cache_used > limit) {
+                icon_cache_remove(g_queue_peek_tail(&icon_cache_lru));
+                icon_cache_evictions++;
+        }
+}
+
+/**
+ * Find the cached icon for key. Icons loaded from files, which
+ * have been modified since, get dropped.
+ *
+ * @return (transfer none) the entry or NULL
+ */
+static struct icon_cache_entry *icon_cache_lookup(const char *key)
+{
+        struct icon_cache_entry *e;
+        struct stat st;
+
+        if (!icon_cache || !(e = g_hash_table_lookup(icon_cache, key)))
+                return NULL;
+
+        if (   e->path
+            && (   stat(e->path, &st) != 0
+                || st.st_mtime != e->mtime
+                || st.st_size != e->fsize)) {
+                LOG_D("Icon cache: '%s' changed on disk", e->path);
+                icon_cache_remove(e);
+                return NULL;
+        }
+
+        g_queue_unlink(&icon_cache_lru, e->lru);
+        g_queue_push_head_link(&icon_cache_lru, e->lru);
+
+        return e;
+}
+
+/**
+ * Add a surface to the cache, if it fits into the cache's memory limit.
+ *
+ * @param key (transfer full) The key of the icon
+ * @param surface (nullable) (transfer none) The surface to cache
+ * @param path (nullable) (transfer full) The file the icon got loaded from
+ */
+static void icon_cache_insert(char *key, cairo_surface_t *surface, char *path)
+{
+        gsize limit = (gsize) settings.icon_cache_size * 1024;
+        struct icon_cache_entry *e;
+        struct stat st;
+
+        if (   !surface
+            || cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS
+            || (path && stat(path, &st) != 0)) {
+                g_free(key);
+                g_free(path);
+                return;
+        }
+
+        e = g_malloc(sizeof(struct icon_cache_entry));
+        e->key = key;
+        e->surface = cairo_surface_reference(surface);
+        e->size = (gsize) cairo_image_surface_get_stride(surface)
+                * cairo_image_surface_get_height(surface);
+        e->path = path;
+        e->mtime = path ? st.st_mtime : 0;
+        e->fsize = path ? st.st_size : 0;
+
+        if (e->size > limit) {
+                icon_cache_entry_free(e);
+                return;
+        }
+
+        if (!icon_cache)
+                icon_cache = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                   NULL, icon_cache_entry_free);
+
+        struct icon_cache_entry *old = g_hash_table_lookup(icon_cache, key);
+        if (old)
+                icon_cache_remove(old);
+
+        icon_cache_evict(limit - e->size);
+
+        g_queue_push_head(&icon_cache_lru, e);
+        e->lru = icon_cache_lru.head;
+        icon_cache_used += e->size;
+        g_hash_table_insert(icon_cache, e->key, e);
+}
 
+/**
+ * Build the cache key for raw icon data by its pixels. The pixels get
+ * hashed only on the first lookup, as the icon gets looked up on every
+ * redraw.
+ */
+static char *icon_cache_key_raw(struct raw_image *raw, int size)
+{
+        if (!raw->checksum) {
+                gsize len = (raw->height - 1) * raw->rowstride
+                          + raw->width * ((raw->n_channels * raw->bits_per_sample + 7) / 8);
+                raw->checksum = g_compute_checksum_for_data(G_CHECKSUM_SHA256, raw->data, len);
+        }
+
+        return g_strdup_printf("raw:%dx%d:%d:%d:%d:%d:%s:%d",
+                               raw->width, raw->height, raw->rowstride,
+                               raw->has_alpha, raw->bits_per_sample,
+                               raw->n_channels, raw->checksum, size);
+}
+
+/* see icon.h */
+void icon_cache_teardown(void)
+{
+        LOG_D("Icon cache: %u hits, %u misses, %u evictions",
+              icon_cache_hits, icon_cache_misses, icon_cache_evictions);
+
+        g_queue_clear(&icon_cache_lru);
+        g_clear_pointer(&icon_cache, g_hash_table_unref);
+        icon_cache_used = 0;
+}
+
+/**
+ * Premultiply the color channels of a pixel with its alpha value.
+ *
+ * The red and blue channels get multiplied in parallel within a single
+ * word, the green channel separately. The products get rounded the same
+ * way as cairo does it, so a premultiplied pixel is identical to the
+ * pixel loaded by cairo itself.
+ *
+ * @param rgb The pixel in 0x00RRGGBB notation
+ * @param a The alpha value
+ * @return the premultiplied pixel in ARGB32 notation
+ */
+static inline uint32_t premultiply(uint32_t rgb, uint32_t a)
+{
+        uint32_t rb = (rgb & 0xff00ff) * a + 0x800080;
+        uint32_t g  = (rgb & 0x00ff00) * a + 0x008000;
+
+        rb = ((rb + ((rb >> 8) & 0xff00ff)) >> 8) & 0xff00ff;
+        g  = ((g  + ((g  >> 8) & 0x00ff00)) >> 8) & 0x00ff00;
+
+        return (a << 24) | rb | g;
+}
+
+#ifdef __SSE2__
+/**
+ * Premultiply four RGBA pixels and swap them into ARGB32 notation.
+ *
+ * The channels get widened to 16 bits and multiplied with the alpha
+ * value, the alpha channel itself with 255, which keeps it unchanged
+ * with the rounding of premultiply().
+ *
+ * @param rgba Four pixels in RGBA byte order
+ * @return the premultiplied pixels as little endian ARGB32 words
+ */
+static inline __m128i premultiply_sse2(__m128i rgba)
+{
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i alpha_lane = _mm_set_epi16(0xff, 0, 0, 0, 0xff, 0, 0, 0);
+        const __m128i color_lanes = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+        const __m128i round = _mm_set1_epi16(0x80);
+        __m128i halves[2] = {
+                _mm_unpacklo_epi8(rgba, zero),
+                _mm_unpackhi_epi8(rgba, zero),
+        };
+
+        for (int i = 0; i < 2; i++) {
+                __m128i c = halves[i];
+                __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 3, 3)),
+                                                _MM_SHUFFLE(3, 3, 3, 3));
+                a = _mm_or_si128(_mm_and_si128(a, color_lanes), alpha_lane);
+
+                __m128i t = _mm_add_epi16(_mm_mullo_epi16(c, a), round);
+                t = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+
+                /* RGBA -> BGRA, which is ARGB32 in little endian */
+                halves[i] = _mm_shufflehi_epi16(_mm_shufflelo_epi16(t, _MM_SHUFFLE(3, 0, 1, 2)),
+                                                _MM_SHUFFLE(3, 0, 1, 2));
+        }
+
+        return _mm_packus_epi16(halves[0], halves[1]);
+}
+
+/**
+ * Expand the first four RGB pixels of \p rgb into RGB24 pixels.
+ *
+ * @param rgb Four pixels in RGB byte order, followed by four more bytes
+ * @return the pixels as little endian RGB24 words
+ */
+static inline __m128i expand_rgb_sse2(__m128i rgb)
+{
+        const __m128i byte = _mm_set1_epi32(0xff);
+        const __m128i opaque = _mm_set1_epi32(0xff000000);
+
+        /* move the pixels into their own words, the top byte is junk */
+        __m128i p = _mm_unpacklo_epi64(
+                        _mm_unpacklo_epi32(rgb, _mm_srli_si128(rgb, 3)),
+                        _mm_unpacklo_epi32(_mm_srli_si128(rgb, 6), _mm_srli_si128(rgb, 9)));
+
+        __m128i r = _mm_slli_epi32(_mm_and_si128(p, byte), 16);
+        __m128i g = _mm_and_si128(p, _mm_set1_epi32(0xff00));
+        __m128i b = _mm_and_si128(_mm_srli_epi32(p, 16), byte);
+
+        return _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, opaque));
+}
+#endif
+
+/**
+ * Convert a row of RGBA pixels into premultiplied ARGB32 pixels.
+ *
+ * With SSE2, four pixels get converted at once and only the rest of the
+ * row gets converted pixel by pixel.
+ */
+static void convert_row_rgba(uint32_t *dst, const guchar *src, int width)
+{
+        int x = 0;
+
+#ifdef __SSE2__
+        for (; x + 4 <= width; x += 4) {
+                __m128i rgba = _mm_loadu_si128((const __m128i *) (src + 4 * x));
+                _mm_storeu_si128((__m128i *) (dst + x), premultiply_sse2(rgba));
+        }
+#endif
+
+        for (; x < width; x++) {
+                const guchar *p = src + 4 * x;
+                uint32_t rgb = (uint32_t) p[0] << 16 | (uint32_t) p[1] << 8 | p[2];
+
+                dst[x] = premultiply(rgb, p[3]);
+        }
+}
+
+/**
+ * Convert a row of RGB pixels into RGB24 pixels.
+ *
+ * With SSE2, four pixels get converted at once, as long as the 16 bytes
+ * loaded for them don't exceed the row.
+ */
+static void convert_row_rgb(uint32_t *dst, const guchar *src, int width)
+{
+        int x = 0;
+
+#ifdef __SSE2__
+        for (; 3 * x + 16 <= 3 * width; x += 4) {
+                __m128i rgb = _mm_loadu_si128((const __m128i *) (src + 3 * x));
+                _mm_storeu_si128((__m128i *) (dst + x), expand_rgb_sse2(rgb));
+        }
+#endif
+
+        for (; x < width; x++) {
+                const guchar *p = src + 3 * x;
+
+                dst[x] = 0xff000000 | (uint32_t) p[0] << 16 | (uint32_t) p[1] << 8 | p[2];
+        }
+}
+
+/* see icon.h */
 cairo_surface_t *gdk_pixbuf_to_cairo_surface(GdkPixbuf *pixbuf)
 {
         /*
-         * Export the gdk pixbuf into buffer as a png and import the png buffer
-         * via cairo again as a cairo_surface_t.
-         * It looks counterintuitive, as there is gdk_cairo_set_source_pixbuf,
-         * which does the job faster. But this would require gtk3 as a dependency
+         * Convert the pixel data directly into the cairo surface, as
+         * gdk_cairo_set_source_pixbuf would require gtk3 as a dependency
          * for a single function call. See discussion in #334 and #376.
          */
-        cairo_surface_t *icon_surface = NULL;
-        GByteArray *buffer;
-        char *bufstr;
-        gsize buflen;
+        int width = gdk_pixbuf_get_width(pixbuf);
+        int height = gdk_pixbuf_get_height(pixbuf);
+        int n_channels = gdk_pixbuf_get_n_channels(pixbuf);
+        bool has_alpha = gdk_pixbuf_get_has_alpha(pixbuf);
+        int src_stride = gdk_pixbuf_get_rowstride(pixbuf);
+        const guchar *src = gdk_pixbuf_get_pixels(pixbuf);
+
+        if (   gdk_pixbuf_get_bits_per_sample(pixbuf) != 8
+            || n_channels != (has_alpha ? 4 : 3)) {
+                LOG_W("Unsupported pixel format of icon: %d channels with %d bits",
+                      n_channels, gdk_pixbuf_get_bits_per_sample(pixbuf));
+                return NULL;
+        }
+
+        cairo_surface_t *icon_surface = cairo_image_surface_create(
+                        has_alpha ? CAIRO_FORMAT_ARGB32 : CAIRO_FORMAT_RGB24,
+                        width, height);
+
+        if (cairo_surface_status(icon_surface) != CAIRO_STATUS_SUCCESS)
+                return icon_surface;
 
-        gdk_pixbuf_save_to_buffer(pixbuf, &bufstr, &buflen, "png", NULL, NULL);
+        cairo_surface_flush(icon_surface);
 
-        buffer = g_byte_array_new_take((guint8*)bufstr, buflen);
-        icon_surface = cairo_image_surface_create_from_png_stream(read_from_buf, buffer);
+        unsigned char *dst = cairo_image_surface_get_data(icon_surface);
+        int dst_stride = cairo_image_surface_get_stride(icon_surface);
 
-        g_byte_array_free(buffer, TRUE);
+        for (int y = 0; y < height; y++) {
+                uint32_t *dst_row = (uint32_t *) (dst + y * dst_stride);
+                const guchar *src_row = src + y * src_stride;
+
+                if (has_alpha)
+                        convert_row_rgba(dst_row, src_row, width);
+                else
+                        convert_row_rgb(dst_row, src_row, width);
+        }
+
+        cairo_surface_mark_dirty(icon_surface);
 
         return icon_surface;
 }
@@ -67,12 +579,18 @@ GdkPixbuf *get_pixbuf_from_file(const char *filename)
         return pixbuf;
 }
 
-GdkPixbuf *get_pixbuf_from_icon(const char *iconname)
+/**
+ * Retrieve an icon by its name, see get_pixbuf_from_icon().
+ *
+ * @param iconname The name of the icon
+ * @param path (nullable) Return location for the file, which
+ *             the icon got loaded from
+ */
+static GdkPixbuf *get_pixbuf_and_path_from_icon(const char *iconname, char **path)
 {
         if (STR_EMPTY(iconname))
                 return NULL;
 
-        const char *suffixes[] = { ".svg", ".png", ".xpm", NULL };
         GdkPixbuf *pixbuf = NULL;
         gchar *uri_path = NULL;
 
@@ -85,8 +603,28 @@ GdkPixbuf *get_pixbuf_from_icon(const char *iconname)
         /* absolute path? */
         if (iconname[0] == '/' || iconname[0] == '~') {
                 pixbuf = get_pixbuf_from_file(iconname);
+                if (pixbuf && path)
+                        *path = string_to_path(g_strdup(iconname));
+        } else if (!strchr(iconname, '/')) {
+        /* look up in the index of the icon_path */
+                GQueue *candidates = icon_index_lookup(iconname);
+
+                for (GList *iter = candidates ? candidates->head : NULL; iter; iter = iter->next) {
+                        struct icon_candidate *c = iter->data;
+
+                        if (is_readable_file(c->path))
+                                pixbuf = get_pixbuf_from_file(c->path);
+
+                        if (pixbuf) {
+                                if (path)
+                                        *path = g_strdup(c->path);
+                                break;
+                        }
+                }
+                if (!pixbuf)
+                        LOG_W("No icon found in path: '%s'", iconname);
         } else {
-        /* search in icon_path */
+        /* search subfolders of icon_path, which are not indexed */
                 char *start = settings.icon_path,
                      *end, *current_folder, *maybe_icon_path;
                 do {
@@ -95,11 +633,15 @@ GdkPixbuf *get_pixbuf_from_icon(const char *iconname)
 
                         current_folder = g_strndup(start, end - start);
 
-                        for (const char **suf = suffixes; *suf; suf++) {
+                        for (const char **suf = icon_suffixes; *suf; suf++) {
                                 maybe_icon_path = g_strconcat(current_folder, "/", iconname, *suf, NULL);
                                 if (is_readable_file(maybe_icon_path))
                                         pixbuf = get_pixbuf_from_file(maybe_icon_path);
-                                g_free(maybe_icon_path);
+
+                                if (pixbuf && path)
+                                        *path = maybe_icon_path;
+                                else
+                                        g_free(maybe_icon_path);
 
                                 if (pixbuf)
                                         break;
@@ -119,6 +661,12 @@ GdkPixbuf *get_pixbuf_from_icon(const char *iconname)
         return pixbuf;
 }
 
+/* see icon.h */
+GdkPixbuf *get_pixbuf_from_icon(const char *iconname)
+{
+        return get_pixbuf_and_path_from_icon(iconname, NULL);
+}
+
 GdkPixbuf *get_pixbuf_from_raw_image(const struct raw_image *raw_image)
 {
         GdkPixbuf *pixbuf = NULL;
@@ -136,19 +684,36 @@ GdkPixbuf *get_pixbuf_from_raw_image(const struct raw_image *raw_image)
         return pixbuf;
 }
 
+/* see icon.h */
 cairo_surface_t *icon_get_for_notification(const struct notification *n)
 {
         GdkPixbuf *pixbuf;
+        char *key, *path = NULL;
 
         if (n->raw_icon)
-                pixbuf = get_pixbuf_from_raw_image(n->raw_icon);
+                key = icon_cache_key_raw(n->raw_icon, settings.max_icon_size);
         else if (n->icon)
-                pixbuf = get_pixbuf_from_icon(n->icon);
+                key = g_strdup_printf("icon:%s:%d", n->icon, settings.max_icon_size);
         else
                 return NULL;
 
-        if (!pixbuf)
+        struct icon_cache_entry *cached = icon_cache_lookup(key);
+        if (cached) {
+                icon_cache_hits++;
+                g_free(key);
+                return cairo_surface_reference(cached->surface);
+        }
+        icon_cache_misses++;
+
+        if (n->raw_icon)
+                pixbuf = get_pixbuf_from_raw_image(n->raw_icon);
+        else
+                pixbuf = get_pixbuf_and_path_from_icon(n->icon, &path);
+
+        if (!pixbuf) {
+                g_free(key);
                 return NULL;
+        }
 
         int w = gdk_pixbuf_get_width(pixbuf);
         int h = gdk_pixbuf_get_height(pixbuf);
@@ -172,6 +737,8 @@ cairo_surface_t *icon_get_for_notification(const struct notification *n)
 
         cairo_surface_t *ret = gdk_pixbuf_to_cairo_surface(pixbuf);
         g_object_unref(pixbuf);
+
+        icon_cache_insert(key, ret, path);
         return ret;
 }
 
@@ -6,6 +6,15 @@
 
 #include "notification.h"
 
+/** Convert a `GdkPixbuf` into a cairo surface.
+ *
+ * Pixbufs with alpha channel get converted to premultiplied
+ * CAIRO_FORMAT_ARGB32, all others to CAIRO_FORMAT_RGB24.
+ *
+ * @param pixbuf A pixbuf with 8 bits per sample in RGB or RGBA format
+ *
+ * @return a new cairo_surface_t or `NULL` if the pixel format is not supported
+ */
 cairo_surface_t *gdk_pixbuf_to_cairo_surface(GdkPixbuf *pixbuf);
 
 /** Retrieve an icon by its full filepath.
@@ -20,7 +29,7 @@ GdkPixbuf *get_pixbuf_from_file(const char *filename);
  *
  * @param iconname A string describing a `file://` URL, an arbitary filename
  *                 or an icon name, which then gets searched for in the
- *                 settings.icon_path
+ *                 settings.icon_path via the index of icon_index_setup()
  *
  * @return an instance of `GdkPixbuf` or `NULL` if not found
  */
@@ -30,13 +39,36 @@ GdkPixbuf *get_pixbuf_from_icon(const char *iconname);
  */
 GdkPixbuf *get_pixbuf_from_raw_image(const struct raw_image *raw_image);
 
+/**
+ * Index the icons in the folders of settings.icon_path and watch
+ * the folders for changes.
+ *
+ * A previously built index gets replaced. If settings.icon_path changes,
+ * the index gets rebuilt automatically on the next lookup.
+ */
+void icon_index_setup(void);
+
+/**
+ * Free the icon index and stop watching the folders
+ */
+void icon_index_teardown(void);
+
 /**
  * Get a cairo surface with the appropriate icon for the notification, scaled
  * according to the current settings
  *
+ * Decoded icons are kept in a LRU cache limited by settings.icon_cache_size.
+ * Icons loaded from files are reloaded after the file has been modified.
+ *
  * @return a cairo_surface_t pointer or NULL if no icon could be retrieved.
+ *         The caller has to release it with cairo_surface_destroy().
  */
 cairo_surface_t *icon_get_for_notification(const struct notification *n);
 
+/**
+ * Free all cached icons and log the statistics of the cache
+ */
+void icon_cache_teardown(void);
+
 #endif
 /* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -12,24 +12,6 @@
 #include "settings.h"
 #include "utils.h"
 
-/**
- * Convert all HTML special symbols to HTML entities.
- * @param str (nullable)
- */
-static char *markup_quote(char *str)
-{
-        if (!str)
-                return NULL;
-
-        str = string_replace_all("&", "&amp;", str);
-        str = string_replace_all("\"", "&quot;", str);
-        str = string_replace_all("'", "&apos;", str);
-        str = string_replace_all("<", "&lt;", str);
-        str = string_replace_all(">", "&gt;", str);
-
-        return str;
-}
-
 /**
  * Convert all HTML special entities to their actual char.
  * @param str (nullable)
@@ -48,21 +30,6 @@ static char *markup_unquote(char *str)
         return str;
 }
 
-/**
- * Convert all HTML linebreak tags to a newline character
- * @param str (nullable)
- */
-static char *markup_br2nl(char *str)
-{
-        if (!str)
-                return NULL;
-
-        str = string_replace_all("<br>", "\n", str);
-        str = string_replace_all("<br/>", "\n", str);
-        str = string_replace_all("<br />", "\n", str);
-        return str;
-}
-
 /* see markup.h */
 void markup_strip_a(char **str, char **urls)
 {
@@ -247,10 +214,6 @@ static bool markup_is_entity(const char *str)
         assert(str);
         assert(*str == '&');
 
-        char *end = strchr(str, ';');
-        if (!end)
-                return false;
-
         // Parse (hexa)decimal entities with the format &#1234; or &#xABC;
         if (str[1] == '#') {
                 const char *cur = str + 2;
@@ -262,7 +225,7 @@ static bool markup_is_entity(const char *str)
                         if (*cur == ';')
                                 return false;
 
-                        while (isxdigit(*cur) && cur < end)
+                        while (isxdigit(*cur))
                                 cur++;
                 } else {
 
@@ -270,11 +233,11 @@ static bool markup_is_entity(const char *str)
                         if (*cur == ';')
                                 return false;
 
-                        while (isdigit(*cur) && cur < end)
+                        while (isdigit(*cur))
                                 cur++;
                 }
 
-                return (cur == end);
+                return *cur == ';';
         } else {
                 const char *supported_tags[] = {"&amp;", "&lt;", "&gt;", "&quot;", "&apos;"};
                 for (int i = 0; i < sizeof(supported_tags)/sizeof(*supported_tags); i++) {
@@ -286,28 +249,329 @@ static bool markup_is_entity(const char *str)
 }
 
 /**
- * Escape all unsupported and invalid &-entities in a string. If the resulting
- * string does not fit it will be reallocated.
+ * The entities, which markup_strip() and the MARKUP_STRIP mode
+ * convert back to their actual char
+ */
+static const struct {
+        const char *entity;
+        char c;
+} markup_entities[] = {
+        { "&quot;", '"' },
+        { "&apos;", '\'' },
+        { "&lt;",   '<' },
+        { "&gt;",   '>' },
+        { "&amp;",  '&' },
+};
+
+/**
+ * Get the length of the HTML linebreak tag \p str starts with
  *
- * @param str The string to be transformed
+ * @return the length of the tag or 0, if there's none
  */
-static char *markup_escape_unsupported(char *str)
+static int markup_br_len(const char *str)
 {
-        if (!str)
-                return NULL;
+        if (!STRN_EQ(str, "<br", 3))
+                return 0;
+        if (str[3] == '>')
+                return 4;
+        if (STRN_EQ(str + 3, "/>", 2))
+                return 5;
+        if (STRN_EQ(str + 3, " />", 3))
+                return 6;
+        return 0;
+}
+
+/**
+ * The result of markup_transform(), which gets written front to back
+ * into a buffer allocated once for the worst case.
+ */
+struct markup_writer {
+        char *buf;
+        char *pos;
+};
+
+static inline void markup_put(struct markup_writer *w, char c)
+{
+        if (c == '\n' && settings.ignore_newline)
+                c = ' ';
+        *w->pos++ = c;
+}
+
+static inline void markup_put_str(struct markup_writer *w, const char *str)
+{
+        while (*str)
+                markup_put(w, *str++);
+}
+
+/**
+ * Copy the run of chars \p str starts with, which contains none of the
+ * chars in \p special, verbatim
+ *
+ * @return the first char not copied
+ */
+static inline const char *markup_put_plain(struct markup_writer *w, const char *str, const char *special)
+{
+        size_t len = strcspn(str, special);
+        memcpy(w->pos, str, len);
+        w->pos += len;
+        return str + len;
+}
+
+/**
+ * Write the char, converting HTML special symbols to their entities
+ */
+static void markup_put_quoted(struct markup_writer *w, char c)
+{
+        switch (c) {
+        case '&':  markup_put_str(w, "&amp;");  break;
+        case '"':  markup_put_str(w, "&quot;"); break;
+        case '\'': markup_put_str(w, "&apos;"); break;
+        case '<':  markup_put_str(w, "&lt;");   break;
+        case '>':  markup_put_str(w, "&gt;");   break;
+        default:   markup_put(w, c);            break;
+        }
+}
+
+/**
+ * A reader, which returns the chars of a string with all tags
+ * stripped and all linebreak tags converted to newlines, like
+ * string_strip_delimited() does after markup_br2nl().
+ */
+struct markup_strip_reader {
+        const char *pos;
+        int depth;      /**< the number of currently open '<' */
+};
+
+static char markup_strip_next(struct markup_strip_reader *r)
+{
+        while (*r->pos) {
+                /* linebreak tags inside of a tag leave the depth as is */
+                if (r->depth > 0 && !*(r->pos += strcspn(r->pos, "<>")))
+                        break;
+
+                int br = markup_br_len(r->pos);
+                if (br) {
+                        r->pos += br;
+                        if (r->depth == 0)
+                                return '\n';
+                        continue;
+                }
+
+                char c = *r->pos++;
+                if (c == '<')
+                        r->depth++;
+                else if (c == '>' && r->depth > 0)
+                        r->depth--;
+                else if (r->depth == 0)
+                        return c;
+        }
+        return '\0';
+}
 
-        char *match = str;
-        while ((match = strchr(match, '&'))) {
-                if (!markup_is_entity(match)) {
-                        int pos = match - str;
-                        str = string_replace_at(str, pos, 1, "&amp;");
-                        match = str + pos + strlen("&amp;");
+/**
+ * MARKUP_STRIP: Strip all tags, unquote the entities and quote the
+ * result again.
+ *
+ * The entities get recognized in the stripped text, so they may span
+ * across removed tags. A lookahead of the longest entity is sufficient,
+ * everything else gets copied in runs.
+ */
+static void markup_transform_strip(struct markup_writer *w, const char *str)
+{
+        struct markup_strip_reader r = { str, 0 };
+        char la[8];
+        int len = 0;
+
+        while (true) {
+                if (len == 0 && r.depth == 0)
+                        r.pos = markup_put_plain(w, r.pos, "<>&\"'\n");
+
+                if (len == 0 && !(la[len++] = markup_strip_next(&r)))
+                        break;
+                /* only an entity needs the lookahead */
+                while (la[0] == '&' && len < 6 && (la[len] = markup_strip_next(&r)))
+                        len++;
+
+                int consumed = 1;
+                char c = la[0];
+                for (int i = 0; c == '&' && i < G_N_ELEMENTS(markup_entities); i++) {
+                        int elen = strlen(markup_entities[i].entity);
+                        if (elen <= len && STRN_EQ(la, markup_entities[i].entity, elen)) {
+                                c = markup_entities[i].c;
+                                consumed = elen;
+                                break;
+                        }
+                }
+                markup_put_quoted(w, c);
+
+                len -= consumed;
+                memmove(la, la + consumed, len);
+        }
+}
+
+/**
+ * Write the text between \p start and \p end with unsupported
+ * &-entities escaped and linebreak tags converted to newlines.
+ */
+static void markup_put_full(struct markup_writer *w, const char *start, const char *end)
+{
+        const char *c = start;
+        while (c < end) {
+                int br = markup_br_len(c);
+                if (br) {
+                        markup_put(w, '\n');
+                        c += br;
+                } else if (*c == '&' && !markup_is_entity(c)) {
+                        markup_put_str(w, "&amp;");
+                        c++;
                 } else {
-                        match++;
+                        markup_put(w, *c++);
                 }
         }
+}
 
-        return str;
+/**
+ * Find the closing '>' of the img tag \p str points to, skipping the
+ * linebreak tags, which are newlines already in the transformed text.
+ *
+ * @return the '>' or NULL, if there's none
+ */
+static const char *markup_img_end(const char *str)
+{
+        for (const char *c = str; *c; c++) {
+                int br = markup_br_len(c);
+                if (br)
+                        c += br - 1;
+                else if (*c == '>')
+                        return c;
+        }
+        return NULL;
+}
+
+/**
+ * Find the closing '>' of the a tag \p str points to, skipping the linebreak
+ * tags, which are newlines already in the transformed text.
+ *
+ * The first \p skip closing a tags are ignored entirely, as they belong
+ * to links opened before. If another closing a tag appears before the
+ * '>', \p close points to it.
+ *
+ * @return the '>' or NULL, if there's none before the end or the next
+ *         closing a tag
+ */
+static const char *markup_a_end(const char *str, int skip, const char **close)
+{
+        *close = NULL;
+
+        for (const char *c = str; *c; c++) {
+                int br = markup_br_len(c);
+                if (br) {
+                        c += br - 1;
+                } else if (STRN_EQ(c, "</a>", 4)) {
+                        if (skip == 0) {
+                                *close = c;
+                                return NULL;
+                        }
+                        skip--;
+                        c += 3;
+                } else if (*c == '>') {
+                        return c;
+                }
+        }
+        return NULL;
+}
+
+/**
+ * Find the text, which replaces an img tag: the value of its alt
+ * attribute, if it's valid according to the rules of
+ * markup_strip_img().
+ *
+ * @return true, if there's a valid alt attribute
+ */
+static bool markup_img_alt(const char *start, const char *end, const char **text_s, const char **text_e)
+{
+        const char *alt_s = g_strstr_len(start, end - start, "alt=\"");
+        const char *src_s = g_strstr_len(start, end - start, "src=\"");
+        const char *alt_e = NULL;
+
+        if (alt_s) {
+                alt_s += strlen("alt=\"");
+                alt_e = g_strstr_len(alt_s, end - alt_s, "\"");
+        }
+        if (src_s)
+                src_s += strlen("src=\"");
+
+        if (!alt_e)
+                return false;
+
+        *text_s = alt_s;
+        *text_e = alt_e;
+
+        /* the alt value must not overlap with the src attribute */
+        return !src_s || src_s < alt_s || alt_e < src_s - strlen("src=\"");
+}
+
+/**
+ * MARKUP_FULL: Escape unsupported entities, convert linebreaks, replace
+ * img tags with their alt text and strip a tags, keeping their text.
+ *
+ * Handles broken tags the same way markup_strip_a() and
+ * markup_strip_img() do: a link without a '>' or with its closing tag
+ * inside of the opening tag stops processing further links. An image
+ * without a '>' cuts off the rest of the text.
+ */
+static void markup_transform_full(struct markup_writer *w, const char *str)
+{
+        const char *c = str;
+        const char *end, *close;
+        int links_open = 0;
+        bool links_broken = false;
+
+        while (*(c = markup_put_plain(w, c, "<&\n"))) {
+                int br = markup_br_len(c);
+                if (br) {
+                        markup_put(w, '\n');
+                        c += br;
+                } else if (!links_broken && STRN_EQ(c, "<a", 2)) {
+                        end = markup_a_end(c, links_open, &close);
+                        if (close) {
+                                /* the closing tag belongs to the broken one */
+                                LOG_W("Given link is broken: '%.*s.'",
+                                      (int)(close + 4 - c), c);
+                                c = close + strlen("</a>");
+                                links_broken = true;
+                                links_open = 0;
+                        } else if (!end) {
+                                LOG_W("Given link is broken: '%s'", c);
+                                return;
+                        } else {
+                                c = end + 1;
+                                links_open++;
+                        }
+                } else if (links_open > 0 && STRN_EQ(c, "</a>", 4)) {
+                        c += strlen("</a>");
+                        links_open--;
+                } else if (STRN_EQ(c, "<img", 4)) {
+                        /* the alt text replaces the whole tag */
+                        end = markup_img_end(c);
+                        if (!end) {
+                                LOG_W("Given image is broken: '%s'", c);
+                                return;
+                        }
+
+                        const char *alt_s, *alt_e;
+                        if (markup_img_alt(c, end, &alt_s, &alt_e))
+                                markup_put_full(w, alt_s, alt_e);
+                        else
+                                markup_put_str(w, "[image]");
+                        c = end + 1;
+                } else if (*c == '&' && !markup_is_entity(c)) {
+                        markup_put_str(w, "&amp;");
+                        c++;
+                } else {
+                        markup_put(w, *c++);
+                }
+        }
 }
 
 /* see markup.h */
@@ -316,32 +580,30 @@ char *markup_transform(char *str, enum markup_mode markup_mode)
         if (!str)
                 return NULL;
 
+        /* No mode makes a char longer than &quot; */
+        struct markup_writer w;
+        w.buf = w.pos = g_malloc(strlen(str) * 6 + 1);
+
         switch (markup_mode) {
         case MARKUP_NULL:
                 /* `assert(false)`, but with a meaningful error message */
                 assert(markup_mode != MARKUP_NULL);
                 break;
         case MARKUP_NO:
-                str = markup_quote(str);
+                for (const char *c = str; *(c = markup_put_plain(&w, c, "&\"'<>\n")); c++)
+                        markup_put_quoted(&w, *c);
                 break;
         case MARKUP_STRIP:
-                str = markup_br2nl(str);
-                str = markup_strip(str);
-                str = markup_quote(str);
+                markup_transform_strip(&w, str);
                 break;
         case MARKUP_FULL:
-                str = markup_escape_unsupported(str);
-                str = markup_br2nl(str);
-                markup_strip_a(&str, NULL);
-                markup_strip_img(&str, NULL);
+                markup_transform_full(&w, str);
                 break;
         }
+        *w.pos = '\0';
 
-        if (settings.ignore_newline) {
-                str = string_replace_all("\n", " ", str);
-        }
-
-        return str;
+        g_free(str);
+        return g_realloc(w.buf, w.pos - w.buf + 1);
 }
 
 /* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
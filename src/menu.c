@@ -4,7 +4,6 @@
 
 #include <errno.h>
 #include <glib.h>
-#include <regex.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -20,47 +19,234 @@
 #include "settings.h"
 #include "utils.h"
 
-static bool is_initialized = false;
-static regex_t url_regex;
-
 struct notification_lock {
         struct notification *n;
         gint64 timeout;
 };
 static gpointer context_menu_thread(gpointer data);
 
+/*
+ * The URLs get recognized by a DFA, which implements the grammar
+ *
+ *   \b(https?://|ftps?://|news://|mailto:|file://|www\.)
+ *   [-[:alnum:]_\@;/?:&=%$.+!*',~#]*
+ *   (\([-[:alnum:]_\@;/?:&=%$.+!*',~#]*\)|[-[:alnum:]_\@;/?:&=%$+*~])+
+ *
+ * with the leftmost-longest semantics of a case insensitive POSIX regex.
+ * Non-ASCII letters and digits count as alnum, like in a UTF-8 locale.
+ */
+
+/**
+ * The classes of chars, which the DFA distinguishes
+ */
+enum url_class {
+        URL_C_OTHER,    /**< not part of an URL */
+        URL_C_END,      /**< may appear anywhere in an URL */
+        URL_C_INNER,    /**< may not end an URL, except inside of parentheses */
+        URL_C_OPEN,
+        URL_C_CLOSE,
+        URL_C_COUNT,
+};
+
 /**
- * Initializes regexes needed for matching.
+ * The states of the DFA after the scheme of the URL
+ */
+enum url_state {
+        URL_S_DEAD,
+        URL_S_HEAD,     /**< before the first parenthesis */
+        URL_S_HEAD_ACC, /**< before the first parenthesis, after an #URL_C_END */
+        URL_S_PAREN,    /**< inside of parentheses */
+        URL_S_TAIL,     /**< after a closing parenthesis */
+};
+
+static const char url_dfa[][URL_C_COUNT] = {
+        /*                 OTHER       END             INNER       OPEN         CLOSE */
+        [URL_S_DEAD]     = { URL_S_DEAD, URL_S_DEAD,     URL_S_DEAD, URL_S_DEAD,  URL_S_DEAD },
+        [URL_S_HEAD]     = { URL_S_DEAD, URL_S_HEAD_ACC, URL_S_HEAD, URL_S_PAREN, URL_S_DEAD },
+        [URL_S_HEAD_ACC] = { URL_S_DEAD, URL_S_HEAD_ACC, URL_S_HEAD, URL_S_PAREN, URL_S_DEAD },
+        [URL_S_PAREN]    = { URL_S_DEAD, URL_S_PAREN,    URL_S_PAREN, URL_S_DEAD, URL_S_TAIL },
+        [URL_S_TAIL]     = { URL_S_DEAD, URL_S_TAIL,     URL_S_DEAD, URL_S_PAREN, URL_S_DEAD },
+};
+
+static const char *url_schemes[] = {
+        "http://", "https://", "ftp://", "ftps://",
+        "news://", "mailto:", "file://", "www.",
+};
+
+/**
+ * The properties of ASCII chars outside of URLs
+ */
+enum url_flags {
+        URL_F_WORD = 1 << 0,   /**< alnum or '_', for the \\b before the scheme */
+        URL_F_SCHEME = 1 << 1, /**< the first char of a scheme */
+};
+
+/* Keep these tables constant, extract_urls() runs in the context menu thread */
+static const char url_ascii_class[128] = {
+        ['0'] = URL_C_END, ['1'] = URL_C_END, ['2'] = URL_C_END,
+        ['3'] = URL_C_END, ['4'] = URL_C_END, ['5'] = URL_C_END,
+        ['6'] = URL_C_END, ['7'] = URL_C_END, ['8'] = URL_C_END,
+        ['9'] = URL_C_END,
+        ['A'] = URL_C_END, ['B'] = URL_C_END, ['C'] = URL_C_END,
+        ['D'] = URL_C_END, ['E'] = URL_C_END, ['F'] = URL_C_END,
+        ['G'] = URL_C_END, ['H'] = URL_C_END, ['I'] = URL_C_END,
+        ['J'] = URL_C_END, ['K'] = URL_C_END, ['L'] = URL_C_END,
+        ['M'] = URL_C_END, ['N'] = URL_C_END, ['O'] = URL_C_END,
+        ['P'] = URL_C_END, ['Q'] = URL_C_END, ['R'] = URL_C_END,
+        ['S'] = URL_C_END, ['T'] = URL_C_END, ['U'] = URL_C_END,
+        ['V'] = URL_C_END, ['W'] = URL_C_END, ['X'] = URL_C_END,
+        ['Y'] = URL_C_END, ['Z'] = URL_C_END,
+        ['a'] = URL_C_END, ['b'] = URL_C_END, ['c'] = URL_C_END,
+        ['d'] = URL_C_END, ['e'] = URL_C_END, ['f'] = URL_C_END,
+        ['g'] = URL_C_END, ['h'] = URL_C_END, ['i'] = URL_C_END,
+        ['j'] = URL_C_END, ['k'] = URL_C_END, ['l'] = URL_C_END,
+        ['m'] = URL_C_END, ['n'] = URL_C_END, ['o'] = URL_C_END,
+        ['p'] = URL_C_END, ['q'] = URL_C_END, ['r'] = URL_C_END,
+        ['s'] = URL_C_END, ['t'] = URL_C_END, ['u'] = URL_C_END,
+        ['v'] = URL_C_END, ['w'] = URL_C_END, ['x'] = URL_C_END,
+        ['y'] = URL_C_END, ['z'] = URL_C_END,
+        ['-'] = URL_C_END, ['_'] = URL_C_END, ['\\'] = URL_C_END,
+        ['@'] = URL_C_END, [';'] = URL_C_END, ['/'] = URL_C_END,
+        ['?'] = URL_C_END, [':'] = URL_C_END, ['&'] = URL_C_END,
+        ['='] = URL_C_END, ['%'] = URL_C_END, ['$'] = URL_C_END,
+        ['+'] = URL_C_END, ['*'] = URL_C_END, ['~'] = URL_C_END,
+        ['.'] = URL_C_INNER, ['!'] = URL_C_INNER, ['\''] = URL_C_INNER,
+        [','] = URL_C_INNER, ['#'] = URL_C_INNER,
+        ['('] = URL_C_OPEN, [')'] = URL_C_CLOSE,
+};
+
+/* The first chars of #url_schemes in both cases get #URL_F_SCHEME */
+static const char url_ascii_flags[128] = {
+        ['0'] = URL_F_WORD, ['1'] = URL_F_WORD, ['2'] = URL_F_WORD,
+        ['3'] = URL_F_WORD, ['4'] = URL_F_WORD, ['5'] = URL_F_WORD,
+        ['6'] = URL_F_WORD, ['7'] = URL_F_WORD, ['8'] = URL_F_WORD,
+        ['9'] = URL_F_WORD,
+        ['A'] = URL_F_WORD, ['B'] = URL_F_WORD, ['C'] = URL_F_WORD,
+        ['D'] = URL_F_WORD, ['E'] = URL_F_WORD, ['G'] = URL_F_WORD,
+        ['I'] = URL_F_WORD, ['J'] = URL_F_WORD, ['K'] = URL_F_WORD,
+        ['L'] = URL_F_WORD, ['O'] = URL_F_WORD, ['P'] = URL_F_WORD,
+        ['Q'] = URL_F_WORD, ['R'] = URL_F_WORD, ['S'] = URL_F_WORD,
+        ['T'] = URL_F_WORD, ['U'] = URL_F_WORD, ['V'] = URL_F_WORD,
+        ['X'] = URL_F_WORD, ['Y'] = URL_F_WORD, ['Z'] = URL_F_WORD,
+        ['a'] = URL_F_WORD, ['b'] = URL_F_WORD, ['c'] = URL_F_WORD,
+        ['d'] = URL_F_WORD, ['e'] = URL_F_WORD, ['g'] = URL_F_WORD,
+        ['i'] = URL_F_WORD, ['j'] = URL_F_WORD, ['k'] = URL_F_WORD,
+        ['l'] = URL_F_WORD, ['o'] = URL_F_WORD, ['p'] = URL_F_WORD,
+        ['q'] = URL_F_WORD, ['r'] = URL_F_WORD, ['s'] = URL_F_WORD,
+        ['t'] = URL_F_WORD, ['u'] = URL_F_WORD, ['v'] = URL_F_WORD,
+        ['x'] = URL_F_WORD, ['y'] = URL_F_WORD, ['z'] = URL_F_WORD,
+        ['_'] = URL_F_WORD,
+        ['f'] = URL_F_WORD | URL_F_SCHEME, ['h'] = URL_F_WORD | URL_F_SCHEME,
+        ['m'] = URL_F_WORD | URL_F_SCHEME, ['n'] = URL_F_WORD | URL_F_SCHEME,
+        ['w'] = URL_F_WORD | URL_F_SCHEME,
+        ['F'] = URL_F_WORD | URL_F_SCHEME, ['H'] = URL_F_WORD | URL_F_SCHEME,
+        ['M'] = URL_F_WORD | URL_F_SCHEME, ['N'] = URL_F_WORD | URL_F_SCHEME,
+        ['W'] = URL_F_WORD | URL_F_SCHEME,
+};
+
+/**
+ * Decode the char at \p str and advance \p str behind it.
+ * Invalid UTF-8 reads as a single U+FFFD.
+ */
+static gunichar url_next_char(const char **str)
+{
+        gunichar c = (guchar) **str;
+
+        if (c < 0x80) {
+                (*str)++;
+                return c;
+        }
+
+        c = g_utf8_get_char_validated(*str, -1);
+        if (c == (gunichar) -1 || c == (gunichar) -2) {
+                (*str)++;
+                return 0xFFFD;
+        }
+        *str = g_utf8_next_char(*str);
+        return c;
+}
+
+static enum url_class url_char_class(gunichar c)
+{
+        if (c < 128)
+                return url_ascii_class[c];
+        return g_unichar_isalnum(c) ? URL_C_END : URL_C_OTHER;
+}
+
+static bool url_is_word_char(gunichar c)
+{
+        if (c < 128)
+                return url_ascii_flags[c] & URL_F_WORD;
+        return g_unichar_isalnum(c);
+}
+
+/**
+ * @return the length of the URL scheme \p str starts with or 0
+ */
+static int url_scheme_len(const char *str)
+{
+        char first = g_ascii_tolower(*str);
+
+        for (int i = 0; i < G_N_ELEMENTS(url_schemes); i++) {
+                if (url_schemes[i][0] != first)
+                        continue;
+
+                int len = strlen(url_schemes[i]);
+                if (g_ascii_strncasecmp(str, url_schemes[i], len) == 0)
+                        return len;
+        }
+        return 0;
+}
+
+/**
+ * Run the DFA on the rest of an URL following its scheme
  *
- * @return true if initialization succeeded
+ * @return the end of the longest URL or NULL, if there's none
  */
-static bool regex_init(void)
+static const char *url_scan(const char *str)
 {
-        if (is_initialized)
-                return true;
-
-        char *regex =
-            "\\b(https?://|ftps?://|news://|mailto:|file://|www\\.)"
-            "[-[:alnum:]_\\@;/?:&=%$.+!*\x27,~#]*"
-            "(\\([-[:alnum:]_\\@;/?:&=%$.+!*\x27,~#]*\\)|[-[:alnum:]_\\@;/?:&=%$+*~])+";
-        int code = regcomp(&url_regex, regex, REG_EXTENDED | REG_ICASE);
-        if (code != 0) {
-                char error_buf[120];
-                regerror(code, &url_regex, error_buf, sizeof(error_buf));
-                LOG_W("Failed to compile URL-matching regex: %s", error_buf);
-                return false;
-        } else {
-                is_initialized = true;
-                return true;
+        const char *end = NULL;
+        enum url_state state = URL_S_HEAD;
+
+        for (const char *c = str; *c; ) {
+                state = url_dfa[state][url_char_class(url_next_char(&c))];
+                if (state == URL_S_DEAD)
+                        break;
+                if (state == URL_S_HEAD_ACC || state == URL_S_TAIL)
+                        end = c;
         }
+        return end;
 }
 
-void regex_teardown(void)
+/**
+ * Find the first URL in \p str
+ *
+ * @param str The string to search, its start counts as word boundary
+ * @param end Gets set to the end of the URL
+ * @return the start of the URL or NULL, if there's none
+ */
+static const char *url_find(const char *str, const char **end)
 {
-        if (is_initialized) {
-                regfree(&url_regex);
-                is_initialized = false;
+        bool after_word = false;
+
+        for (const char *p = str; *p; ) {
+                guchar c = *p;
+
+                if (c >= 0x80) {
+                        after_word = url_is_word_char(url_next_char(&p));
+                        continue;
+                }
+
+                if (!after_word && url_ascii_flags[c] & URL_F_SCHEME) {
+                        int len = url_scheme_len(p);
+                        if (len && (*end = url_scan(p + len)))
+                                return p;
+                }
+
+                after_word = url_ascii_flags[c] & URL_F_WORD;
+                p++;
         }
+        return NULL;
 }
 
 /*
@@ -72,37 +258,23 @@ void regex_teardown(void)
 char *extract_urls(const char *to_match)
 {
         char *urls = NULL;
+        const char *start, *end;
 
-        if (!regex_init())
-                return NULL;
-
-        const char *p = to_match;
-        regmatch_t m;
-
-        while (1) {
-                int nomatch = regexec(&url_regex, p, 1, &m, 0);
-                if (nomatch) {
-                        return urls;
-                }
-                int start;
-                int finish;
-                if (m.rm_so == -1) {
-                        break;
-                }
-                start = m.rm_so + (p - to_match);
-                finish = m.rm_eo + (p - to_match);
-
-                char *match = g_strndup(to_match + start, finish - start);
-
+        for (const char *p = to_match; (start = url_find(p, &end)); p = end) {
+                char *match = g_strndup(start, end - start);
                 urls = string_append(urls, match, "\n");
-
                 g_free(match);
-
-                p += m.rm_eo;
         }
         return urls;
 }
 
+/* see menu.h */
+bool contains_url(const char *str)
+{
+        const char *end;
+        return url_find(str, &end);
+}
+
 /*
  * Open url in browser.
  *
@@ -297,8 +469,10 @@ static gpointer context_menu_thread(gpointer data)
                 struct notification *n = iter->data;
 
 
+                const char *urls = notification_get_urls(n);
+
                 // Reference and lock the notification if we need it
-                if (n->urls || n->actions) {
+                if (urls || n->actions) {
                         notification_ref(n);
 
                         struct notification_lock *nl =
@@ -311,12 +485,12 @@ static gpointer context_menu_thread(gpointer data)
                         locked_notifications = g_list_prepend(locked_notifications, nl);
                 }
 
-                if (n->urls)
-                        dmenu_input = string_append(dmenu_input, n->urls, "\n");
+                if (urls)
+                        dmenu_input = string_append(dmenu_input, urls, "\n");
 
                 if (n->actions)
                         dmenu_input =
-                            string_append(dmenu_input, n->actions->dmenu_str,
+                            string_append(dmenu_input, notification_get_dmenu_str(n),
                                           "\n");
         }
 
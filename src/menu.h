@@ -2,10 +2,18 @@
 #ifndef DUNST_MENU_H
 #define DUNST_MENU_H
 
+#include <stdbool.h>
+
 char *extract_urls(const char *to_match);
+
+/**
+ * Check if the string contains an URL, which extract_urls() would find,
+ * without extracting it.
+ */
+bool contains_url(const char *str);
+
 void open_browser(const char *in);
 void invoke_action(const char *action);
-void regex_teardown(void);
 
 /**
  * Open the context menu that lets the user select urls/actions/etc.
@@ -41,12 +41,31 @@ const char *enum_to_string_fullscreen(enum behavior_fullscreen in)
         }
 }
 
+/**
+ * How much is known about the URLs of a notification
+ */
+enum urls_state {
+        URLS_UNKNOWN,   /**< nothing */
+        URLS_NONE,      /**< there are none */
+        URLS_EXIST,     /**< there are some, but they aren't extracted yet */
+        URLS_EXTRACTED, /**< notification.urls is valid */
+};
+
 struct _notification_private {
         gint refcount;
+        gpointer render_data;          /**< cached data of the renderer */
+        GDestroyNotify render_data_free;
+        gint urls_state;               /**< the #urls_state of notification.urls */
 };
 
+/**
+ * Guards the lazily derived fields, which the context menu thread
+ * may compute, too.
+ */
+static GMutex derived_lock;
+
 /* see notification.h */
-void notification_print(const struct notification *n)
+void notification_print(struct notification *n)
 {
         //TODO: use logging info for this
         printf("{\n");
@@ -67,7 +86,7 @@ void notification_print(const struct notification *n)
         printf("\tprogress: %d\n", n->progress);
         printf("\tstack_tag: %s\n", (n->stack_tag ? n->stack_tag : ""));
         printf("\tid: %d\n", n->id);
-        if (n->urls) {
+        if (notification_get_urls(n)) {
                 char *urls = string_replace_all("\n", "\t\t\n", g_strdup(n->urls));
                 printf("\turls:\n");
                 printf("\t{\n");
@@ -84,7 +103,7 @@ void notification_print(const struct notification *n)
                                n->actions->actions[i + 1]);
                 }
                 printf("\t}\n");
-                printf("\tactions_dmenu: %s\n", n->actions->dmenu_str);
+                printf("\tactions_dmenu: %s\n", notification_get_dmenu_str(n));
         }
         printf("\tscript: %s\n", n->script);
         printf("}\n");
@@ -193,6 +212,25 @@ int notification_is_duplicate(const struct notification *a, const struct notific
             && a->urgency == b->urgency;
 }
 
+/**
+ * Hash all fields of a notification, which notification_is_duplicate()
+ * compares. Duplicates always share the same fingerprint.
+ *
+ * @param n The notification to hash
+ */
+static guint notification_fingerprint(const struct notification *n)
+{
+        guint hash = g_str_hash(n->appname);
+
+        hash = hash * 31 + g_str_hash(n->summary);
+        hash = hash * 31 + g_str_hash(n->body);
+        if (settings.icon_position != ICON_OFF && n->icon)
+                hash = hash * 31 + g_str_hash(n->icon);
+        hash = hash * 31 + n->urgency;
+
+        return hash;
+}
+
 /* see notification.h */
 void actions_free(struct actions *a)
 {
@@ -211,14 +249,36 @@ void rawimage_free(struct raw_image *i)
                 return;
 
         g_free(i->data);
+        g_free(i->checksum);
         g_free(i);
 }
 
 static void notification_private_free(NotificationPrivate *p)
 {
+        if (p->render_data_free)
+                p->render_data_free(p->render_data);
+
         g_free(p);
 }
 
+/* see notification.h */
+gpointer notification_get_render_data(const struct notification *n)
+{
+        return n->priv->render_data;
+}
+
+/* see notification.h */
+void notification_set_render_data(struct notification *n, gpointer data, GDestroyNotify destroy)
+{
+        NotificationPrivate *p = n->priv;
+
+        if (p->render_data_free)
+                p->render_data_free(p->render_data);
+
+        p->render_data = data;
+        p->render_data_free = destroy;
+}
+
 /* see notification.h */
 gint notification_refcount_get(struct notification *n)
 {
@@ -243,18 +303,18 @@ void notification_unref(struct notification *n)
         if (!g_atomic_int_dec_and_test(&n->priv->refcount))
                 return;
 
-        g_free(n->appname);
+        string_release(n->appname);
         g_free(n->summary);
         g_free(n->body);
-        g_free(n->icon);
+        string_release(n->icon);
         g_free(n->msg);
         g_free(n->dbus_client);
-        g_free(n->category);
+        string_release(n->category);
         g_free(n->text_to_render);
         g_free(n->urls);
-        g_free(n->colors.fg);
-        g_free(n->colors.bg);
-        g_free(n->colors.frame);
+        string_release(n->colors.fg);
+        string_release(n->colors.bg);
+        string_release(n->colors.frame);
         g_free(n->stack_tag);
 
         actions_free(n->actions);
@@ -329,10 +389,10 @@ struct notification *notification_create(void)
 void notification_init(struct notification *n)
 {
         /* default to empty string to avoid further NULL faults */
-        n->appname  = n->appname  ? n->appname  : g_strdup("unknown");
+        n->appname  = n->appname  ? n->appname  : string_intern("unknown");
         n->summary  = n->summary  ? n->summary  : g_strdup("");
         n->body     = n->body     ? n->body     : g_strdup("");
-        n->category = n->category ? n->category : g_strdup("");
+        n->category = n->category ? n->category : string_intern("");
 
         /* sanitize urgency */
         if (n->urgency < URG_MIN)
@@ -346,9 +406,9 @@ void notification_init(struct notification *n)
 
         /* Icon handling */
         if (STR_EMPTY(n->icon))
-                g_clear_pointer(&n->icon, g_free);
+                g_clear_pointer(&n->icon, string_release);
         if (!n->raw_icon && !n->icon)
-                n->icon = g_strdup(settings.icons[n->urgency]);
+                n->icon = string_intern(settings.icons[n->urgency]);
 
         /* Color hints */
         struct notification_colors defcolors;
@@ -366,11 +426,11 @@ void notification_init(struct notification *n)
                         g_error("Unhandled urgency type: %d", n->urgency);
         }
         if (!n->colors.fg)
-                n->colors.fg = g_strdup(defcolors.fg);
+                n->colors.fg = string_intern(defcolors.fg);
         if (!n->colors.bg)
-                n->colors.bg = g_strdup(defcolors.bg);
+                n->colors.bg = string_intern(defcolors.bg);
         if (!n->colors.frame)
-                n->colors.frame = g_strdup(defcolors.frame);
+                n->colors.frame = string_intern(defcolors.frame);
 
         /* Sanitize misc hints */
         if (n->progress < 0)
@@ -380,105 +440,213 @@ void notification_init(struct notification *n)
         rule_apply_all(n);
 
         /* UPDATE derived fields */
-        notification_extract_urls(n);
-        notification_dmenu_string(n);
+        n->fingerprint = notification_fingerprint(n);
         notification_format_message(n);
+
+        /* the URLs and the dmenu string get derived on demand */
+        g_clear_pointer(&n->urls, g_free);
+        g_atomic_int_set(&n->priv->urls_state, URLS_UNKNOWN);
+        if (n->actions)
+                g_clear_pointer(&n->actions->dmenu_str, g_free);
 }
 
-static void notification_format_message(struct notification *n)
+/**
+ * A piece of a compiled format string. Either literal text or a
+ * reference to a field of the notification.
+ */
+struct format_token {
+        char field;       /**< the format specifier or '\0' for literal text */
+        const char *text; /**< the literal text, points into format_template.text */
+        size_t len;
+};
+
+struct format_template {
+        char *format;     /**< the original format string */
+        char *text;       /**< the format with escaped newlines replaced */
+        GArray *tokens;   /**< the struct format_token of the format */
+};
+
+/* all format specifiers, which refer to a field */
+static const char format_fields[] = "asbIipn";
+
+static GHashTable *format_templates = NULL;
+
+/* Most notifications share the same format string, so
+ * notification_format_compile() skips hashing it, if it's the same
+ * as last time */
+static const char *last_format = NULL;
+static struct format_template *last_template = NULL;
+
+static void format_template_free(gpointer data)
 {
-        g_clear_pointer(&n->msg, g_free);
+        struct format_template *t = data;
 
-        n->msg = string_replace_all("\\n", "\n", g_strdup(n->format));
+        g_array_unref(t->tokens);
+        g_free(t->text);
+        g_free(t->format);
+        g_free(t);
+}
 
-        /* replace all formatter */
-        for(char *substr = strchr(n->msg, '%');
-                  substr && *substr;
-                  substr = strchr(substr, '%')) {
+static void format_template_add(struct format_template *t, char field, const char *text, size_t len)
+{
+        if (!field && len == 0)
+                return;
 
-                char pg[16];
-                char *icon_tmp;
+        struct format_token token = { field, text, len };
+        g_array_append_val(t->tokens, token);
+}
 
-                switch(substr[1]) {
-                case 'a':
-                        notification_replace_single_field(
-                                &n->msg,
-                                &substr,
-                                n->appname,
-                                MARKUP_NO);
-                        break;
-                case 's':
-                        notification_replace_single_field(
-                                &n->msg,
-                                &substr,
-                                n->summary,
-                                MARKUP_NO);
-                        break;
-                case 'b':
-                        notification_replace_single_field(
-                                &n->msg,
-                                &substr,
-                                n->body,
-                                n->markup);
-                        break;
-                case 'I':
-                        icon_tmp = g_strdup(n->icon);
-                        notification_replace_single_field(
-                                &n->msg,
-                                &substr,
-                                icon_tmp ? basename(icon_tmp) : "",
-                                MARKUP_NO);
-                        g_free(icon_tmp);
-                        break;
-                case 'i':
-                        notification_replace_single_field(
-                                &n->msg,
-                                &substr,
-                                n->icon ? n->icon : "",
-                                MARKUP_NO);
-                        break;
-                case 'p':
-                        if (n->progress != -1)
-                                sprintf(pg, "[%3d%%]", n->progress);
-
-                        notification_replace_single_field(
-                                &n->msg,
-                                &substr,
-                                n->progress != -1 ? pg : "",
-                                MARKUP_NO);
-                        break;
-                case 'n':
-                        if (n->progress != -1)
-                                sprintf(pg, "%d", n->progress);
-
-                        notification_replace_single_field(
-                                &n->msg,
-                                &substr,
-                                n->progress != -1 ? pg : "",
-                                MARKUP_NO);
-                        break;
-                case '%':
-                        notification_replace_single_field(
-                                &n->msg,
-                                &substr,
-                                "%",
-                                MARKUP_NO);
-                        break;
-                case '\0':
+/* see notification.h */
+const struct format_template *notification_format_compile(const char *format)
+{
+        if (!format_templates)
+                format_templates = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                         NULL, format_template_free);
+
+        if (last_template && last_format == format && STR_EQ(last_template->format, format))
+                return last_template;
+
+        struct format_template *t = g_hash_table_lookup(format_templates, format);
+        if (t) {
+                last_format = format;
+                return last_template = t;
+        }
+
+        t = g_malloc(sizeof(struct format_template));
+        t->format = g_strdup(format);
+        t->text = string_replace_all("\\n", "\n", g_strdup(format));
+        t->tokens = g_array_new(false, false, sizeof(struct format_token));
+
+        const char *literal = t->text;
+        const char *substr = t->text;
+        while ((substr = strchr(substr, '%'))) {
+                if (substr[1] && strchr(format_fields, substr[1])) {
+                        format_template_add(t, '\0', literal, substr - literal);
+                        format_template_add(t, substr[1], NULL, 0);
+                        substr += 2;
+                        literal = substr;
+                } else if (substr[1] == '%') {
+                        /* keep the first %, drop the second one */
+                        format_template_add(t, '\0', literal, substr + 1 - literal);
+                        substr += 2;
+                        literal = substr;
+                } else if (substr[1] == '\0') {
                         LOG_W("format_string has trailing %% character. "
                               "To escape it use %%%%.");
                         substr++;
-                        break;
-                default:
+                } else {
                         LOG_W("format_string %%%c is unknown.", substr[1]);
                         // shift substr pointer forward,
                         // as we can't interpret the format string
                         substr++;
-                        break;
+                }
+        }
+        format_template_add(t, '\0', literal, strlen(literal));
+
+        g_hash_table_insert(format_templates, t->format, t);
+        last_format = format;
+        return last_template = t;
+}
+
+/* see notification.h */
+void notification_format_teardown(void)
+{
+        g_clear_pointer(&format_templates, g_hash_table_unref);
+        last_format = NULL;
+        last_template = NULL;
+}
+
+/**
+ * Get the value of a single format field, quoted according to the
+ * markup settings.
+ */
+static char *notification_format_field(const struct notification *n, char field)
+{
+        char *value = NULL;
+        enum markup_mode markup = MARKUP_NO;
+        char *icon_tmp;
+
+        switch (field) {
+        case 'a':
+                value = g_strdup(n->appname);
+                break;
+        case 's':
+                value = g_strdup(n->summary);
+                break;
+        case 'b':
+                value = g_strdup(n->body);
+                markup = n->markup;
+                break;
+        case 'I':
+                icon_tmp = g_strdup(n->icon);
+                value = g_strdup(icon_tmp ? basename(icon_tmp) : "");
+                g_free(icon_tmp);
+                break;
+        case 'i':
+                value = g_strdup(n->icon);
+                break;
+        case 'p':
+                if (n->progress != -1)
+                        value = g_strdup_printf("[%3d%%]", n->progress);
+                break;
+        case 'n':
+                if (n->progress != -1)
+                        value = g_strdup_printf("%d", n->progress);
+                break;
+        default:
+                LOG_E("Invalid %s enum value in %s:%d", "format field", __FILE__, __LINE__);
+                break;
+        }
+
+        return markup_transform(value ? value : g_strdup(""), markup);
+}
+
+static void notification_format_message(struct notification *n)
+{
+        g_clear_pointer(&n->msg, g_free);
+
+        const struct format_template *t = notification_format_compile(n->format);
+
+        /* Every field gets transformed only once, even if it's
+         * used multiple times */
+        char *values[sizeof(format_fields)] = { NULL };
+        size_t value_lens[sizeof(format_fields)] = { 0 };
+        size_t len = 0;
+
+        for (guint i = 0; i < t->tokens->len; i++) {
+                struct format_token *token = &g_array_index(t->tokens, struct format_token, i);
+                if (token->field) {
+                        int idx = strchr(format_fields, token->field) - format_fields;
+                        if (!values[idx]) {
+                                values[idx] = notification_format_field(n, token->field);
+                                value_lens[idx] = strlen(values[idx]);
+                        }
+                        len += value_lens[idx];
+                } else {
+                        len += token->len;
                 }
         }
 
-        n->msg = g_strchomp(n->msg);
+        /* As the size is known, the message is written in one pass */
+        char *msg = g_malloc(len + 1);
+        char *pos = msg;
+        for (guint i = 0; i < t->tokens->len; i++) {
+                struct format_token *token = &g_array_index(t->tokens, struct format_token, i);
+                if (token->field) {
+                        int idx = strchr(format_fields, token->field) - format_fields;
+                        memcpy(pos, values[idx], value_lens[idx]);
+                        pos += value_lens[idx];
+                } else {
+                        memcpy(pos, token->text, token->len);
+                        pos += token->len;
+                }
+        }
+        *pos = '\0';
+
+        for (int i = 0; i < sizeof(format_fields); i++)
+                g_free(values[i]);
+
+        n->msg = g_strchomp(msg);
 
         /* truncate overlong messages */
         if (strnlen(n->msg, DUNST_NOTIF_MAX_CHARS + 1) > DUNST_NOTIF_MAX_CHARS) {
@@ -515,7 +683,6 @@ static void notification_extract_urls(struct notification *n)
 static void notification_dmenu_string(struct notification *n)
 {
         if (n->actions) {
-                g_clear_pointer(&n->actions->dmenu_str, g_free);
                 for (int i = 0; i < n->actions->count; i += 2) {
                         char *human_readable = n->actions->actions[i + 1];
                         string_replace_char('[', '(', human_readable); // kill square brackets
@@ -530,6 +697,76 @@ static void notification_dmenu_string(struct notification *n)
         }
 }
 
+/**
+ * Check if the summary or the body contain any markup, which
+ * notification_extract_urls() takes URLs from.
+ */
+static bool notification_has_url_markup(const struct notification *n)
+{
+        return (n->summary && (strstr(n->summary, "<a") || strstr(n->summary, "<img")))
+            || (n->body    && (strstr(n->body,    "<a") || strstr(n->body,    "<img")));
+}
+
+/* see notification.h */
+bool notification_has_urls(struct notification *n)
+{
+        switch (g_atomic_int_get(&n->priv->urls_state)) {
+        case URLS_UNKNOWN:
+                break;
+        case URLS_NONE:
+                return false;
+        case URLS_EXIST:
+                return true;
+        case URLS_EXTRACTED:
+                return n->urls;
+        }
+
+        /* Without links or images, there are URLs exactly if the plain
+         * text contains some. The URLs of links and images need the
+         * actual extraction. */
+        if (notification_has_url_markup(n))
+                return notification_get_urls(n);
+
+        bool exist = (n->summary && contains_url(n->summary))
+                  || (n->body    && contains_url(n->body));
+        g_atomic_int_compare_and_exchange(&n->priv->urls_state, URLS_UNKNOWN,
+                                          exist ? URLS_EXIST : URLS_NONE);
+        return exist;
+}
+
+/* see notification.h */
+const char *notification_get_urls(struct notification *n)
+{
+        gint state = g_atomic_int_get(&n->priv->urls_state);
+        if (state == URLS_NONE)
+                return NULL;
+        if (state == URLS_EXTRACTED)
+                return n->urls;
+
+        g_mutex_lock(&derived_lock);
+        if (g_atomic_int_get(&n->priv->urls_state) != URLS_EXTRACTED) {
+                notification_extract_urls(n);
+                g_atomic_int_set(&n->priv->urls_state, URLS_EXTRACTED);
+        }
+        g_mutex_unlock(&derived_lock);
+
+        return n->urls;
+}
+
+/* see notification.h */
+const char *notification_get_dmenu_str(struct notification *n)
+{
+        if (!n->actions)
+                return NULL;
+
+        g_mutex_lock(&derived_lock);
+        if (!n->actions->dmenu_str)
+                notification_dmenu_string(n);
+        g_mutex_unlock(&derived_lock);
+
+        return n->actions->dmenu_str;
+}
+
 void notification_update_text_to_render(struct notification *n)
 {
         g_clear_pointer(&n->text_to_render, g_free);
@@ -540,15 +777,15 @@ void notification_update_text_to_render(struct notification *n)
 
         /* print dup_count and msg */
         if ((n->dup_count > 0 && !settings.hide_duplicate_count)
-            && (n->actions || n->urls) && settings.show_indicators) {
+            && (n->actions || notification_has_urls(n)) && settings.show_indicators) {
                 buf = g_strdup_printf("(%d%s%s) %s",
                                       n->dup_count,
                                       n->actions ? "A" : "",
-                                      n->urls ? "U" : "", msg);
-        } else if ((n->actions || n->urls) && settings.show_indicators) {
+                                      notification_has_urls(n) ? "U" : "", msg);
+        } else if ((n->actions || notification_has_urls(n)) && settings.show_indicators) {
                 buf = g_strdup_printf("(%s%s) %s",
                                       n->actions ? "A" : "",
-                                      n->urls ? "U" : "", msg);
+                                      notification_has_urls(n) ? "U" : "", msg);
         } else if (n->dup_count > 0 && !settings.hide_duplicate_count) {
                 buf = g_strdup_printf("(%d) %s", n->dup_count, msg);
         } else {
@@ -586,7 +823,7 @@ void notification_update_text_to_render(struct notification *n)
 }
 
 /* see notification.h */
-void notification_do_action(const struct notification *n)
+void notification_do_action(struct notification *n)
 {
         if (n->actions) {
                 if (n->actions->count == 2) {
@@ -601,7 +838,7 @@ void notification_do_action(const struct notification *n)
                 }
                 context_menu();
 
-        } else if (n->urls) {
+        } else if (notification_get_urls(n)) {
                 if (strstr(n->urls, "\n"))
                         context_menu();
                 else
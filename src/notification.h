@@ -34,11 +34,12 @@ struct raw_image {
         int bits_per_sample;
         int n_channels;
         unsigned char *data;
+        char *checksum; /**< SHA-256 of the data, computed once by the icon cache */
 };
 
 struct actions {
         char **actions;
-        char *dmenu_str;
+        char *dmenu_str;      /**< see notification_get_dmenu_str() */
         gsize count;
 };
 
@@ -94,7 +95,8 @@ struct notification {
         /* derived fields */
         char *msg;            /**< formatted message */
         char *text_to_render; /**< formatted message (with age and action indicators) */
-        char *urls;           /**< urllist delimited by '\\n' */
+        char *urls;           /**< urllist delimited by '\\n', see notification_get_urls() */
+        guint fingerprint;    /**< hash of the fields compared by notification_is_duplicate() */
 };
 
 /**
@@ -141,6 +143,24 @@ void actions_free(struct actions *a);
  */
 void rawimage_free(struct raw_image *i);
 
+/**
+ * Retrieve the data attached by the renderer.
+ *
+ * @param n The notification to get the data of
+ * @return (nullable) the data set by notification_set_render_data()
+ */
+gpointer notification_get_render_data(const struct notification *n);
+
+/**
+ * Attach data of the renderer to the notification, which lives as long
+ * as the notification. Previously attached data gets freed.
+ *
+ * @param n The notification to attach the data to
+ * @param data (nullable) (transfer full) The data to attach
+ * @param destroy (nullable) The function to free data
+ */
+void notification_set_render_data(struct notification *n, gpointer data, GDestroyNotify destroy);
+
 /**
  * Decrease the reference counter of the notification.
  *
@@ -173,7 +193,7 @@ void notification_run_script(struct notification *n);
  * print a human readable representation
  * of the given notification to stdout.
  */
-void notification_print(const struct notification *n);
+void notification_print(struct notification *n);
 
 /**
  * Replace the two chars where **needle points
@@ -187,6 +207,24 @@ void notification_replace_single_field(char **haystack,
                                        const char *replacement,
                                        enum markup_mode markup_mode);
 
+struct format_template;
+
+/**
+ * Compile a format string into a template, which renders the message
+ * of notifications without parsing the format again.
+ *
+ * The templates are kept per format string, so compiling the same
+ * format again only costs a lookup.
+ *
+ * @return (transfer none) the template of format
+ */
+const struct format_template *notification_format_compile(const char *format);
+
+/**
+ * Free all templates compiled by notification_format_compile()
+ */
+void notification_format_teardown(void);
+
 void notification_update_text_to_render(struct notification *n);
 
 /**
@@ -194,7 +232,33 @@ void notification_update_text_to_render(struct notification *n);
  * invoke it. If there are multiple and no default, open the context menu. If
  * there are no actions, proceed similarly with urls.
  */
-void notification_do_action(const struct notification *n);
+void notification_do_action(struct notification *n);
+
+/**
+ * Get the URLs of the notification. They get extracted from the summary
+ * and the body on the first call.
+ *
+ * @param n The notification to get the URLs of
+ * @return (nullable) the urllist delimited by '\\n'
+ */
+const char *notification_get_urls(struct notification *n);
+
+/**
+ * Check if the notification has any URLs, which is cheaper than
+ * notification_get_urls() for notifications without links or images.
+ *
+ * @param n The notification to check
+ */
+bool notification_has_urls(struct notification *n);
+
+/**
+ * Get the actions of the notification in the format of the context
+ * menu. It gets built on the first call.
+ *
+ * @param n The notification to get the actions of
+ * @return (nullable) the actions delimited by '\\n'
+ */
+const char *notification_get_dmenu_str(struct notification *n);
 
 const char *notification_urgency_to_string(const enum urgency urgency);
 
@@ -21,27 +21,97 @@
 #include <string.h>
 
 #include "dunst.h"
+#include "heap.h"
 #include "log.h"
 #include "notification.h"
 #include "settings.h"
 #include "utils.h"
 
 /* notification lists */
-static GQueue *waiting   = NULL; /**< all new notifications get into here */
-static GQueue *displayed = NULL; /**< currently displayed notifications */
-static GQueue *history   = NULL; /**< history of displayed notifications */
+static struct heap *waiting = NULL; /**< all new notifications get into here */
+static GQueue *displayed    = NULL; /**< currently displayed notifications */
+static GQueue *history      = NULL; /**< history of displayed notifications */
+
+/**
+ * The position of a notification inside the waiting or displayed queue
+ */
+struct queue_entry {
+        GList *link;              /**< the link in displayed or NULL, if waiting */
+        struct heap_node *node;   /**< the node in waiting or NULL, if displayed */
+        struct queue_entry *next; /**< next entry with the same key */
+};
+
+/* indexes of all notifications in waiting and displayed */
+static GHashTable *ids          = NULL; /**< keyed by notification id */
+static GHashTable *stack_tags   = NULL; /**< keyed by the hash of the stack_tag */
+static GHashTable *fingerprints = NULL; /**< keyed by the notification fingerprint */
+
+/**
+ * The upcoming events of a displayed notification
+ */
+struct queue_timer {
+        struct notification *n;
+        gint64 expire;                 /**< expiry time, may be too early after the user has been idle */
+        gint64 tick;                   /**< next change of the age label */
+        struct heap_node *expire_node; /**< the node in #expiries or NULL, if sticky */
+        struct heap_node *tick_node;   /**< the node in #ticks or NULL, if the age is hidden */
+};
+
+/* deadlines of all displayed notifications */
+static GHashTable *timers   = NULL; /**< keyed by the displayed notification */
+static struct heap *expiries = NULL; /**< ordered by #queue_timer.expire */
+static struct heap *ticks    = NULL; /**< ordered by #queue_timer.tick */
+static gint64 ticks_threshold;      /**< show_age_threshold used for #ticks */
+static gint64 idle_last = 0;        /**< last time the user has been seen idle */
 
 int next_notification_id = 1;
 
 static bool queues_stack_duplicate(struct notification *n);
 static bool queues_stack_by_tag(struct notification *n);
 
+/**
+ * Order of the waiting queue, the notification to display next is in front
+ */
+static int queues_waiting_cmp(gconstpointer a, gconstpointer b)
+{
+        /* Without sorting, the newest notification is in front */
+        return settings.sort ? notification_cmp(a, b) : 0;
+}
+
+/**
+ * Order of the expiries, the earliest expiry is in front
+ */
+static int queues_expiry_cmp(gconstpointer a, gconstpointer b)
+{
+        const struct queue_timer *ta = a, *tb = b;
+        return (ta->expire > tb->expire) - (ta->expire < tb->expire);
+}
+
+/**
+ * Order of the age ticks, the earliest tick is in front
+ */
+static int queues_tick_cmp(gconstpointer a, gconstpointer b)
+{
+        const struct queue_timer *ta = a, *tb = b;
+        return (ta->tick > tb->tick) - (ta->tick < tb->tick);
+}
+
 /* see queues.h */
 void queues_init(void)
 {
         history   = g_queue_new();
         displayed = g_queue_new();
-        waiting   = g_queue_new();
+        waiting   = heap_new(queues_waiting_cmp);
+
+        ids          = g_hash_table_new(g_direct_hash, g_direct_equal);
+        stack_tags   = g_hash_table_new(g_direct_hash, g_direct_equal);
+        fingerprints = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+        timers   = g_hash_table_new(g_direct_hash, g_direct_equal);
+        expiries = heap_new(queues_expiry_cmp);
+        ticks    = heap_new(queues_tick_cmp);
+        ticks_threshold = settings.show_age_threshold;
+        idle_last = 0;
 }
 
 /* see queues.h */
@@ -53,15 +123,14 @@ const GList *queues_get_displayed(void)
 /* see queues.h */
 const struct notification *queues_get_head_waiting(void)
 {
-        if (waiting->length == 0)
-                return NULL;
-        return g_queue_peek_head(waiting);
+        struct heap_node *head = heap_peek(waiting);
+        return head ? head->data : NULL;
 }
 
 /* see queues.h */
 unsigned int queues_length_waiting(void)
 {
-        return waiting->length;
+        return heap_length(waiting);
 }
 
 /* see queues.h */
@@ -77,80 +146,370 @@ unsigned int queues_length_history(void)
 }
 
 /**
- * Swap two given queue elements. The element's data has to be a notification.
+ * Get the notification at the position of an index entry
+ */
+static struct notification *queue_entry_notification(const struct queue_entry *entry)
+{
+        return entry->link ? entry->link->data : entry->node->data;
+}
+
+/**
+ * Look up the entries of all queued notifications with the given key
  *
- * @pre { elemA has to be part of queueA. }
- * @pre { elemB has to be part of queueB. }
+ * @param index The index to search in
+ * @param key   The key of the notification
+ * @return the first entry of the chain or NULL, if no notification matches
+ */
+static struct queue_entry *queues_index_lookup(GHashTable *index, guint key)
+{
+        return g_hash_table_lookup(index, GUINT_TO_POINTER(key));
+}
+
+/**
+ * Add a position to an index
  *
- * @param queueA The queue, which elemB's data will get inserted
- * @param elemA  The element, which will get removed from queueA
- * @param queueB The queue, which elemA's data will get inserted
- * @param elemB  The element, which will get removed from queueB
+ * @param index    The index to add the position to
+ * @param key      The key of the notification in the index
+ * @param position The position of the notification
  */
-static void queues_swap_notifications(GQueue *queueA,
-                                      GList  *elemA,
-                                      GQueue *queueB,
-                                      GList  *elemB)
+static void queues_index_add(GHashTable *index, guint key, struct queue_entry position)
 {
-        struct notification *toB = elemA->data;
-        struct notification *toA = elemB->data;
+        struct queue_entry *entry = g_malloc(sizeof(struct queue_entry));
 
-        g_queue_delete_link(queueA, elemA);
-        g_queue_delete_link(queueB, elemB);
+        *entry = position;
+        entry->next = queues_index_lookup(index, key);
 
-        if (toA)
-                g_queue_insert_sorted(queueA, toA, notification_cmp_data, NULL);
-        if (toB)
-                g_queue_insert_sorted(queueB, toB, notification_cmp_data, NULL);
+        g_hash_table_insert(index, GUINT_TO_POINTER(key), entry);
 }
 
 /**
- * Check if a notification is eligible to get shown.
+ * Remove a notification from an index
  *
- * @param n      The notification to check
- * @param status The current status of dunst
- * @param shown  True if the notification is currently displayed
+ * @param index The index to remove the notification from
+ * @param key   The key of the notification in the index
+ * @param n     The notification, which has to be indexed
  */
-static bool queues_notification_is_ready(const struct notification *n, struct dunst_status status, bool shown)
+static void queues_index_remove(GHashTable *index, guint key, const struct notification *n)
 {
-        if (!status.running)
-                return false;
-        if (status.fullscreen && shown)
-                return n && n->fullscreen != FS_PUSHBACK;
-        else if (status.fullscreen && !shown)
-                return n && n->fullscreen == FS_SHOW;
+        struct queue_entry *prev = NULL;
+
+        for (struct queue_entry *entry = queues_index_lookup(index, key);
+             entry;
+             prev = entry, entry = entry->next) {
+                if (queue_entry_notification(entry) != n)
+                        continue;
+
+                if (prev)
+                        prev->next = entry->next;
+                else if (entry->next)
+                        g_hash_table_insert(index, GUINT_TO_POINTER(key), entry->next);
+                else
+                        g_hash_table_remove(index, GUINT_TO_POINTER(key));
+
+                g_free(entry);
+                return;
+        }
+
+        assert(false);
+}
+
+/**
+ * Find an indexed notification, which matches the given one. Notifications
+ * in displayed take precedence over notifications in waiting.
+ *
+ * @param index The index to search in
+ * @param key   The key of n in the index
+ * @param n     The notification to match
+ * @param match Decides if the queued notification matches n
+ * @return the entry of the matching notification or NULL
+ */
+static struct queue_entry *queues_index_find(GHashTable *index,
+                                             guint key,
+                                             const struct notification *n,
+                                             bool (*match)(const struct notification *queued,
+                                                           const struct notification *n))
+{
+        struct queue_entry *found = NULL;
+
+        for (struct queue_entry *entry = queues_index_lookup(index, key);
+             entry;
+             entry = entry->next) {
+                if (!match(queue_entry_notification(entry), n))
+                        continue;
+                if (entry->link)
+                        return entry;
+                if (!found)
+                        found = entry;
+        }
+
+        return found;
+}
+
+/**
+ * Add the notification at the given position to all indexes
+ *
+ * @param position The position of the notification to index
+ */
+static void queues_index_notification(struct queue_entry position)
+{
+        struct notification *n = queue_entry_notification(&position);
+
+        queues_index_add(ids, n->id, position);
+        queues_index_add(fingerprints, n->fingerprint, position);
+        if (STR_FULL(n->stack_tag))
+                queues_index_add(stack_tags, g_str_hash(n->stack_tag), position);
+}
+
+/**
+ * Remove the notification from all indexes
+ *
+ * @param n The notification to remove
+ */
+static void queues_unindex_notification(const struct notification *n)
+{
+        queues_index_remove(ids, n->id, n);
+        queues_index_remove(fingerprints, n->fingerprint, n);
+        if (STR_FULL(n->stack_tag))
+                queues_index_remove(stack_tags, g_str_hash(n->stack_tag), n);
+}
+
+/**
+ * Calculate the next time after time, when the age label of a
+ * notification changes
+ */
+static gint64 queues_age_tick(const struct notification *n, gint64 time)
+{
+        gint64 age = time - n->timestamp;
+
+        // the next shift of the second
+        if (age > settings.show_age_threshold - S2US(1))
+                return time + S2US(1) - (age % S2US(1));
         else
-                return true;
+                return n->timestamp + settings.show_age_threshold;
 }
 
 /**
- * Check if a notification has timed out
+ * Register the age tick of a timer, if the age gets shown at all
+ */
+static void queues_tick_add(struct queue_timer *t)
+{
+        t->tick_node = NULL;
+        if (settings.show_age_threshold < 0)
+                return;
+
+        /* The tick gets moved to the future in queues_ticks_advance() */
+        t->tick = t->n->timestamp + settings.show_age_threshold;
+        t->tick_node = heap_push(ticks, t);
+}
+
+/**
+ * Move all age ticks, which are not in the future anymore, to the next
+ * change of their age label.
  *
- * @param n the notification to check
- * @param status the current status of dunst
- * @returns true, if the notification is timed out, otherwise false
+ * @param time the current time
+ * @return true, if an age label changed
  */
-static bool queues_notification_is_finished(struct notification *n, struct dunst_status status)
+static bool queues_ticks_advance(gint64 time)
 {
-        assert(n);
+        struct heap_node *node;
+        bool changed = false;
+
+        /* the age threshold got changed, so all ticks are invalid */
+        if (ticks_threshold != settings.show_age_threshold) {
+                while ((node = heap_peek(ticks)))
+                        ((struct queue_timer *) heap_remove(ticks, node))->tick_node = NULL;
+
+                GHashTableIter iter;
+                gpointer t;
+                g_hash_table_iter_init(&iter, timers);
+                while (g_hash_table_iter_next(&iter, NULL, &t))
+                        queues_tick_add(t);
+
+                ticks_threshold = settings.show_age_threshold;
+                changed = true;
+        }
 
-        if (n->timeout == 0) // sticky
-                return false;
+        while ((node = heap_peek(ticks))) {
+                struct queue_timer *t = node->data;
+                if (t->tick > time)
+                        break;
 
-        bool is_idle = status.fullscreen ? false : status.idle;
+                t->tick = queues_age_tick(t->n, time);
+                heap_update(ticks, node);
+                changed = true;
+        }
 
-        /* don't timeout when user is idle */
-        if (is_idle && !n->transient) {
-                n->start = time_monotonic_now();
-                return false;
+        return changed;
+}
+
+/**
+ * Start the timers of a notification, which gets displayed.
+ * The notification's start field has to be set already.
+ */
+static void queues_timer_add(struct notification *n)
+{
+        struct queue_timer *t = g_malloc(sizeof(struct queue_timer));
+
+        t->n = n;
+        t->expire_node = NULL;
+        if (n->timeout > 0) {
+                t->expire = n->start + n->timeout;
+                t->expire_node = heap_push(expiries, t);
         }
+        queues_tick_add(t);
 
-        /* remove old message */
-        if (time_monotonic_now() - n->start > n->timeout) {
-                return true;
+        g_hash_table_insert(timers, n, t);
+}
+
+/**
+ * Stop the timers of a notification, which is not displayed anymore
+ */
+static void queues_timer_remove(const struct notification *n)
+{
+        struct queue_timer *t = g_hash_table_lookup(timers, n);
+        assert(t);
+
+        if (t->expire_node)
+                heap_remove(expiries, t->expire_node);
+        if (t->tick_node)
+                heap_remove(ticks, t->tick_node);
+
+        g_hash_table_remove(timers, n);
+        g_free(t);
+}
+
+/**
+ * Insert a notification into waiting and index it.
+ *
+ * @param n The notification to insert
+ */
+static void queues_waiting_push(struct notification *n)
+{
+        struct queue_entry position = { .node = heap_push(waiting, n) };
+        queues_index_notification(position);
+}
+
+/**
+ * Remove a notification from waiting and from the indexes.
+ *
+ * @param node The node of the notification in waiting
+ * @return the removed notification
+ */
+static struct notification *queues_waiting_remove(struct heap_node *node)
+{
+        queues_unindex_notification(node->data);
+        return heap_remove(waiting, node);
+}
+
+/**
+ * Insert a notification sorted into displayed, index it and start its
+ * timers.
+ *
+ * @param n The notification to insert
+ */
+static void queues_displayed_insert(struct notification *n)
+{
+        GList *sibling = NULL;
+
+        /* Incoming notifications usually belong at the tail, so avoid
+         * walking the whole queue in that case */
+        if (!g_queue_is_empty(displayed)
+            && notification_cmp_data(g_queue_peek_tail(displayed), n, NULL) >= 0) {
+                sibling = g_queue_peek_head_link(displayed);
+                while (notification_cmp_data(sibling->data, n, NULL) < 0)
+                        sibling = sibling->next;
         }
 
-        return false;
+        queues_timer_add(n);
+
+        struct queue_entry position = { 0 };
+        if (sibling) {
+                g_queue_insert_before(displayed, sibling, n);
+                position.link = sibling->prev;
+        } else {
+                g_queue_push_tail(displayed, n);
+                position.link = g_queue_peek_tail_link(displayed);
+        }
+        queues_index_notification(position);
+}
+
+/**
+ * Remove the given link from displayed, the indexes and the timers.
+ *
+ * @param link The link to remove
+ * @return the notification of the removed link
+ */
+static struct notification *queues_displayed_delete(GList *link)
+{
+        struct notification *n = link->data;
+
+        queues_unindex_notification(n);
+        queues_timer_remove(n);
+        g_queue_delete_link(displayed, link);
+
+        return n;
+}
+
+/**
+ * Remove the notification at an indexed position from its queue
+ *
+ * @param entry The position of the notification
+ * @return the removed notification
+ */
+static struct notification *queues_entry_remove(struct queue_entry *entry)
+{
+        if (entry->link)
+                return queues_displayed_delete(entry->link);
+        else
+                return queues_waiting_remove(entry->node);
+}
+
+/**
+ * Put another notification into an indexed position. If the position
+ * is in displayed, the new notification starts now.
+ *
+ * @param entry The position of the notification to replace
+ * @param new   The notification to take over the position
+ * @return the replaced notification
+ */
+static struct notification *queues_entry_replace(struct queue_entry *entry, struct notification *new)
+{
+        /* the entry gets freed while unindexing */
+        struct queue_entry position = *entry;
+        struct notification *old = queue_entry_notification(&position);
+
+        queues_unindex_notification(old);
+        if (position.link) {
+                queues_timer_remove(old);
+                new->start = time_monotonic_now();
+                queues_timer_add(new);
+                position.link->data = new;
+        } else {
+                position.node->data = new;
+                heap_update(waiting, position.node);
+        }
+        queues_index_notification(position);
+
+        return old;
+}
+
+/**
+ * Check if a notification is eligible to get shown.
+ *
+ * @param n      The notification to check
+ * @param status The current status of dunst
+ * @param shown  True if the notification is currently displayed
+ */
+static bool queues_notification_is_ready(const struct notification *n, struct dunst_status status, bool shown)
+{
+        if (!status.running)
+                return false;
+        if (status.fullscreen && shown)
+                return n && n->fullscreen != FS_PUSHBACK;
+        else if (status.fullscreen && !shown)
+                return n && n->fullscreen == FS_SHOW;
+        else
+                return true;
 }
 
 /* see queues.h */
@@ -182,7 +541,7 @@ int queues_notification_insert(struct notification *n)
         if (n->id != 0) {
                 if (!queues_notification_replace_id(n)) {
                         // Requested id was not valid, but play nice and assign it anyway
-                        g_queue_insert_sorted(waiting, n, notification_cmp_data, NULL);
+                        queues_waiting_push(n);
                 }
                 inserted = true;
         } else {
@@ -196,7 +555,7 @@ int queues_notification_insert(struct notification *n)
                 inserted = true;
 
         if (!inserted)
-                g_queue_insert_sorted(waiting, n, notification_cmp_data, NULL);
+                queues_waiting_push(n);
 
         if (settings.print_notifications)
                 notification_print(n);
@@ -204,6 +563,22 @@ int queues_notification_insert(struct notification *n)
         return n->id;
 }
 
+/**
+ * Check if a queued notification is a duplicate of n
+ */
+static bool queues_match_duplicate(const struct notification *queued, const struct notification *n)
+{
+        return notification_is_duplicate(queued, n);
+}
+
+/**
+ * Check if a queued notification has the same stack_tag as n
+ */
+static bool queues_match_stack_tag(const struct notification *queued, const struct notification *n)
+{
+        return STR_FULL(queued->stack_tag) && STR_EQ(queued->stack_tag, n->stack_tag);
+}
+
 /**
  * Replaces duplicate notification and stacks it
  *
@@ -212,35 +587,28 @@ int queues_notification_insert(struct notification *n)
  */
 static bool queues_stack_duplicate(struct notification *n)
 {
-        GQueue *allqueues[] = { displayed, waiting };
-        for (int i = 0; i < sizeof(allqueues)/sizeof(GQueue*); i++) {
-                for (GList *iter = g_queue_peek_head_link(allqueues[i]); iter;
-                     iter = iter->next) {
-                        struct notification *orig = iter->data;
-                        if (notification_is_duplicate(orig, n)) {
-                                /* If the progress differs, probably notify-send was used to update the notification
-                                 * So only count it as a duplicate, if the progress was not the same.
-                                 * */
-                                if (orig->progress == n->progress) {
-                                        orig->dup_count++;
-                                } else {
-                                        orig->progress = n->progress;
-                                }
-                                iter->data = n;
-
-                                n->dup_count = orig->dup_count;
-                                signal_notification_closed(orig, 1);
-
-                                if (allqueues[i] == displayed)
-                                        n->start = time_monotonic_now();
-
-                                notification_unref(orig);
-                                return true;
-                        }
-                }
+        struct queue_entry *entry = queues_index_find(fingerprints, n->fingerprint,
+                                                      n, queues_match_duplicate);
+        if (!entry)
+                return false;
+
+        struct notification *orig = queue_entry_notification(entry);
+
+        /* If the progress differs, probably notify-send was used to update the notification
+         * So only count it as a duplicate, if the progress was not the same.
+         * */
+        if (orig->progress == n->progress) {
+                orig->dup_count++;
+        } else {
+                orig->progress = n->progress;
         }
+        queues_entry_replace(entry, n);
 
-        return false;
+        n->dup_count = orig->dup_count;
+        signal_notification_closed(orig, 1);
+
+        notification_unref(orig);
+        return true;
 }
 
 /**
@@ -251,87 +619,81 @@ static bool queues_stack_duplicate(struct notification *n)
  */
 static bool queues_stack_by_tag(struct notification *new)
 {
-        GQueue *allqueues[] = { displayed, waiting };
-        for (int i = 0; i < sizeof(allqueues)/sizeof(GQueue*); i++) {
-                for (GList *iter = g_queue_peek_head_link(allqueues[i]); iter;
-                            iter = iter->next) {
-                        struct notification *old = iter->data;
-                        if (STR_FULL(old->stack_tag) && STR_EQ(old->stack_tag, new->stack_tag)) {
-                                iter->data = new;
-                                new->dup_count = old->dup_count;
+        struct queue_entry *entry = queues_index_find(stack_tags, g_str_hash(new->stack_tag),
+                                                      new, queues_match_stack_tag);
+        if (!entry)
+                return false;
 
-                                signal_notification_closed(old, 1);
+        bool shown = entry->link;
+        struct notification *old = queues_entry_replace(entry, new);
+        new->dup_count = old->dup_count;
 
-                                if (allqueues[i] == displayed) {
-                                        new->start = time_monotonic_now();
-                                        notification_run_script(new);
-                                }
+        signal_notification_closed(old, 1);
 
-                                notification_unref(old);
-                                return true;
-                        }
-                }
-        }
-        return false;
+        if (shown)
+                notification_run_script(new);
+
+        notification_unref(old);
+        return true;
 }
 
 /* see queues.h */
 bool queues_notification_replace_id(struct notification *new)
 {
-        GQueue *allqueues[] = { displayed, waiting };
-        for (int i = 0; i < sizeof(allqueues)/sizeof(GQueue*); i++) {
-                for (GList *iter = g_queue_peek_head_link(allqueues[i]);
-                            iter;
-                            iter = iter->next) {
-                        struct notification *old = iter->data;
-                        if (old->id == new->id) {
-                                iter->data = new;
-                                new->dup_count = old->dup_count;
-
-                                if (allqueues[i] == displayed) {
-                                        new->start = time_monotonic_now();
-                                        notification_run_script(new);
-                                }
-
-                                notification_unref(old);
-                                return true;
-                        }
-                }
-        }
-        return false;
+        struct queue_entry *entry = queues_index_lookup(ids, new->id);
+
+        if (!entry)
+                return false;
+
+        bool shown = entry->link;
+        struct notification *old = queues_entry_replace(entry, new);
+        new->dup_count = old->dup_count;
+
+        if (shown)
+                notification_run_script(new);
+
+        notification_unref(old);
+        return true;
+}
+
+/**
+ * Close the notification at an indexed position and push it to history
+ *
+ * @param entry  The position of the notification to close
+ * @param reason The #reason to close
+ */
+static void queues_entry_close(struct queue_entry *entry, enum reason reason)
+{
+        struct notification *target = queues_entry_remove(entry);
+
+        //Don't notify clients if notification was pulled from history
+        if (!target->redisplayed)
+                signal_notification_closed(target, reason);
+        queues_history_push(target);
 }
 
 /* see queues.h */
 void queues_notification_close_id(int id, enum reason reason)
 {
-        struct notification *target = NULL;
-
-        GQueue *allqueues[] = { displayed, waiting };
-        for (int i = 0; i < sizeof(allqueues)/sizeof(GQueue*); i++) {
-                for (GList *iter = g_queue_peek_head_link(allqueues[i]); iter;
-                     iter = iter->next) {
-                        struct notification *n = iter->data;
-                        if (n->id == id) {
-                                g_queue_remove(allqueues[i], n);
-                                target = n;
-                                break;
-                        }
-                }
-        }
+        struct queue_entry *entry = queues_index_lookup(ids, id);
 
-        if (target) {
-                //Don't notify clients if notification was pulled from history
-                if (!target->redisplayed)
-                        signal_notification_closed(target, reason);
-                queues_history_push(target);
-        }
+        if (entry)
+                queues_entry_close(entry, reason);
 }
 
 /* see queues.h */
 void queues_notification_close(struct notification *n, enum reason reason)
 {
         assert(n != NULL);
-        queues_notification_close_id(n->id, reason);
+
+        for (struct queue_entry *entry = queues_index_lookup(ids, n->id);
+             entry;
+             entry = entry->next) {
+                if (queue_entry_notification(entry) == n) {
+                        queues_entry_close(entry, reason);
+                        return;
+                }
+        }
 }
 
 /* see queues.h */
@@ -343,7 +705,7 @@ void queues_history_pop(void)
         struct notification *n = g_queue_pop_tail(history);
         n->redisplayed = true;
         n->timeout = settings.sticky_history ? 0 : n->timeout;
-        g_queue_insert_sorted(waiting, n, notification_cmp_data, NULL);
+        queues_waiting_push(n);
 }
 
 /* see queues.h */
@@ -354,7 +716,7 @@ void queues_history_pop_non_sticky(void)
 
         struct notification *n = g_queue_pop_tail(history);
         n->redisplayed = true;
-        g_queue_insert_sorted(waiting, n, notification_cmp_data, NULL);
+        queues_waiting_push(n);
 }
 
 /* see queues.h */
@@ -379,35 +741,125 @@ void queues_history_push_all(void)
                 queues_notification_close(g_queue_peek_head_link(displayed)->data, REASON_USER);
         }
 
-        while (waiting->length > 0) {
-                queues_notification_close(g_queue_peek_head_link(waiting)->data, REASON_USER);
+        while (heap_length(waiting) > 0) {
+                queues_notification_close(heap_peek(waiting)->data, REASON_USER);
         }
 }
 
+/**
+ * Apply a pause of the user to the expiry of a timer. The timeout of
+ * notifications, which have been displayed while the user was idle,
+ * restarts as soon as the user is back.
+ *
+ * This happens lazily, only when a timer is about to expire, so that an
+ * idle user doesn't cause to touch all timers on every update.
+ *
+ * @param t The timer to check
+ * @return true, if the expiry got moved
+ */
+static bool queues_timer_normalize(struct queue_timer *t)
+{
+        if (t->n->transient || t->n->start >= idle_last)
+                return false;
+
+        t->n->start = idle_last;
+        t->expire = t->n->start + t->n->timeout;
+        heap_update(expiries, t->expire_node);
+
+        return true;
+}
+
+/**
+ * Sort helper for queues_waiting_collect_ready(), ordering nodes the
+ * same way as the waiting heap.
+ */
+static gint queues_waiting_node_cmp(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+        return heap_node_cmp(user_data,
+                             *(struct heap_node * const *) a,
+                             *(struct heap_node * const *) b);
+}
+
+/**
+ * Collect all waiting notifications, which are eligible to get shown, in
+ * a single pass over the heap.
+ *
+ * @param status The current status of dunst
+ * @return the nodes in waiting, sorted in the order to get shown.
+ *         Free it with g_ptr_array_free().
+ */
+static GPtrArray *queues_waiting_collect_ready(struct dunst_status status)
+{
+        GPtrArray *ready = g_ptr_array_new();
+
+        for (unsigned int i = 0; i < heap_length(waiting); i++) {
+                struct heap_node *node = heap_nth(waiting, i);
+
+                if (queues_notification_is_ready(node->data, status, false))
+                        g_ptr_array_add(ready, node);
+        }
+        g_ptr_array_sort_with_data(ready, queues_waiting_node_cmp, waiting);
+
+        return ready;
+}
+
+/**
+ * Move a notification from waiting to displayed
+ *
+ * @param node The node of the notification in waiting
+ * @param time The current time
+ */
+static void queues_waiting_show(struct heap_node *node, gint64 time)
+{
+        struct notification *n = queues_waiting_remove(node);
+
+        n->start = time;
+        notification_run_script(n);
+
+        queues_displayed_insert(n);
+}
+
 /* see queues.h */
-void queues_update(struct dunst_status status)
+bool queues_update(struct dunst_status status, gint64 time)
 {
         GList *iter, *nextiter;
+        struct heap_node *next;
+        bool changed = false;
+
+        /* don't timeout when user is idle, the timeouts restart as
+         * soon as the user is back. See queues_timer_normalize(). */
+        bool is_idle = status.fullscreen ? false : status.idle;
+        if (is_idle)
+                idle_last = time;
+
+        /* remove old messages */
+        while ((next = heap_peek(expiries))) {
+                struct queue_timer *t = next->data;
+
+                if (t->expire >= time)
+                        break;
+
+                changed = true;
+                if (queues_timer_normalize(t))
+                        continue;
+
+                queues_notification_close(t->n, REASON_TIME);
+        }
+
+        changed |= queues_ticks_advance(time);
 
         /* Move back all notifications, which aren't eligible to get shown anymore
          * Will move the notifications back to waiting, if dunst isn't running or fullscreen
          * and notifications is not eligible to get shown anymore */
-        iter = g_queue_peek_head_link(displayed);
+        iter = (status.running && !status.fullscreen) ? NULL : g_queue_peek_head_link(displayed);
         while (iter) {
                 struct notification *n = iter->data;
                 nextiter = iter->next;
 
-                if (queues_notification_is_finished(n, status)){
-                        queues_notification_close(n, REASON_TIME);
-                        iter = nextiter;
-                        continue;
-                }
-
                 if (!queues_notification_is_ready(n, status, true)) {
-                        g_queue_delete_link(displayed, iter);
-                        g_queue_insert_sorted(waiting, n, notification_cmp_data, NULL);
-                        iter = nextiter;
-                        continue;
+                        queues_displayed_delete(iter);
+                        queues_waiting_push(n);
+                        changed = true;
                 }
 
                 iter = nextiter;
@@ -418,97 +870,94 @@ void queues_update(struct dunst_status status)
                 cur_displayed_limit = INT_MAX;
         else if (   settings.indicate_hidden
                  && settings.geometry.h > 1
-                 && displayed->length + waiting->length > settings.geometry.h)
+                 && displayed->length + heap_length(waiting) > settings.geometry.h)
                 cur_displayed_limit = settings.geometry.h-1;
         else
                 cur_displayed_limit = settings.geometry.h;
 
         /* move notifications from queue to displayed */
-        iter = g_queue_peek_head_link(waiting);
-        while (displayed->length < cur_displayed_limit && iter) {
-                struct notification *n = iter->data;
-                nextiter = iter->next;
-
-                if (!n)
-                        return;
+        while (   displayed->length < cur_displayed_limit
+               && (next = heap_peek(waiting))
+               && queues_notification_is_ready(next->data, status, false)) {
+                queues_waiting_show(next, time);
+                changed = true;
+        }
 
-                if (!queues_notification_is_ready(n, status, false)) {
-                        iter = nextiter;
-                        continue;
+        /* The head is held back (e.g. by fullscreen), so the eligible
+         * notifications may be anywhere in the heap. Find them all at once
+         * instead of scanning the heap for each of them. */
+        if (   status.running
+            && displayed->length < cur_displayed_limit
+            && heap_length(waiting) > 0) {
+                GPtrArray *ready = queues_waiting_collect_ready(status);
+
+                for (unsigned int i = 0; i < ready->len && displayed->length < cur_displayed_limit; i++) {
+                        queues_waiting_show(g_ptr_array_index(ready, i), time);
+                        changed = true;
                 }
 
-                n->start = time_monotonic_now();
-                notification_run_script(n);
-
-                g_queue_delete_link(waiting, iter);
-                g_queue_insert_sorted(displayed, n, notification_cmp_data, NULL);
-
-                iter = nextiter;
+                g_ptr_array_free(ready, TRUE);
         }
 
         /* if necessary, push the overhanging notifications from displayed to waiting again */
         while (displayed->length > cur_displayed_limit) {
-                struct notification *n = g_queue_pop_tail(displayed);
-                g_queue_insert_sorted(waiting, n, notification_cmp_data, NULL); //TODO: actually it should be on the head if unsorted
+                struct notification *n = queues_displayed_delete(g_queue_peek_tail_link(displayed));
+                queues_waiting_push(n); //TODO: actually it should be on the head if unsorted
+                changed = true;
         }
 
         /* If displayed is actually full, let the more important notifications
          * from waiting seep into displayed.
          */
         if (settings.sort && displayed->length == cur_displayed_limit) {
-                GList *i_waiting, *i_displayed;
+                struct heap_node *i_waiting;
+                GList *i_displayed;
 
-                while (   (i_waiting   = g_queue_peek_head_link(waiting))
+                while (   (i_waiting   = heap_peek(waiting))
                        && (i_displayed = g_queue_peek_tail_link(displayed))) {
 
-                        while (i_waiting && ! queues_notification_is_ready(i_waiting->data, status, false)) {
-                                i_waiting = i_waiting->prev;
-                        }
-
-                        if (i_waiting && notification_cmp(i_displayed->data, i_waiting->data) > 0) {
-                                struct notification *todisp = i_waiting->data;
+                        if (   queues_notification_is_ready(i_waiting->data, status, false)
+                            && notification_cmp(i_displayed->data, i_waiting->data) > 0) {
+                                struct notification *todisp = queues_waiting_remove(i_waiting);
+                                struct notification *towait = queues_displayed_delete(i_displayed);
 
-                                todisp->start = time_monotonic_now();
+                                todisp->start = time;
                                 notification_run_script(todisp);
 
-                                queues_swap_notifications(displayed, i_displayed, waiting, i_waiting);
+                                queues_displayed_insert(todisp);
+                                queues_waiting_push(towait);
+                                changed = true;
                         } else {
                                 break;
                         }
                 }
         }
+
+        return changed;
 }
 
 /* see queues.h */
 gint64 queues_get_next_datachange(gint64 time, struct dunst_status status)
 {
         gint64 sleep = G_MAXINT64;
+        struct heap_node *next;
 
-        for (GList *iter = g_queue_peek_head_link(displayed); iter;
-                        iter = iter->next) {
-                struct notification *n = iter->data;
-                gint64 ttl = n->timeout - (time - n->start);
-
-                if (n->timeout > 0) {
-                        if (ttl > 0)
-                                sleep = MIN(sleep, ttl);
-                        else
-                                // while we're processing, the notification already timed out
-                                return 0;
-                }
+        if ((next = heap_peek(expiries))) {
+                gint64 ttl = ((struct queue_timer *) next->data)->expire - time;
 
-                if (settings.show_age_threshold >= 0) {
-                        gint64 age = time - n->timestamp;
-
-                        // sleep exactly until the next shift of the second happens
-                        if (age > settings.show_age_threshold - S2US(1))
-                                sleep = MIN(sleep, (S2US(1) - (age % S2US(1))));
-                        else
-                                sleep = MIN(sleep, settings.show_age_threshold - age);
-                }
+                if (ttl > 0)
+                        sleep = ttl;
+                else
+                        // while we're processing, the notification already timed out
+                        return 0;
         }
 
-        if (!status.idle && settings.idle_threshold != 0 && settings.repopup_on_idle) {
+        queues_ticks_advance(time);
+        if ((next = heap_peek(ticks)))
+                sleep = MIN(sleep, ((struct queue_timer *) next->data)->tick - time);
+
+        /* Without alarms, dunst has to poll to notice the user going idle */
+        if (!status.idle && settings.idle_threshold != 0 && settings.repopup_on_idle && !x_idle_is_tracked()) {
             sleep = MIN(sleep, settings.idle_threshold - x_get_idle_time() * 1000);
         }
 
@@ -526,14 +975,47 @@ static void teardown_notification(gpointer data)
         notification_unref(n);
 }
 
+/**
+ * Helper function for queues_teardown() to free the index entries of a key
+ */
+static void teardown_index_entries(gpointer key, gpointer value, gpointer user_data)
+{
+        struct queue_entry *entry = value;
+        while (entry) {
+                struct queue_entry *next = entry->next;
+                g_free(entry);
+                entry = next;
+        }
+}
+
+/**
+ * Helper function for queues_teardown() to free a single timer
+ */
+static void teardown_timer(gpointer key, gpointer value, gpointer user_data)
+{
+        g_free(value);
+}
+
 /* see queues.h */
 void queues_teardown(void)
 {
+        g_hash_table_foreach(timers, teardown_timer, NULL);
+        g_clear_pointer(&timers, g_hash_table_unref);
+        heap_free(expiries, NULL);
+        expiries = NULL;
+        heap_free(ticks, NULL);
+        ticks = NULL;
+
+        GHashTable **indexes[] = { &ids, &stack_tags, &fingerprints };
+        for (int i = 0; i < G_N_ELEMENTS(indexes); i++) {
+                g_hash_table_foreach(*indexes[i], teardown_index_entries, NULL);
+                g_clear_pointer(indexes[i], g_hash_table_unref);
+        }
         g_queue_free_full(history, teardown_notification);
         history = NULL;
         g_queue_free_full(displayed, teardown_notification);
         displayed = NULL;
-        g_queue_free_full(waiting, teardown_notification);
+        heap_free(waiting, teardown_notification);
         waiting = NULL;
 }
 
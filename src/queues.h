@@ -94,6 +94,8 @@ void queues_notification_close_id(int id, enum reason reason);
 /**
  * Close the given notification. \see queues_notification_close_id().
  *
+ * Other notifications sharing the id of n are left untouched.
+ *
  * @param n (transfer full) The notification to close
  * @param reason The #reason to close
  * */
@@ -129,12 +131,17 @@ void queues_history_push_all(void);
  * and show them. In displayed queue, the amount of elements is limited
  * to the amount set via queues_displayed_limit()
  *
+ * Notifications, which hit their timeout, get closed. Only the
+ * notifications, which are actually due, get looked at.
+ *
  * @post Call wake_up() to synchronize the queues with the UI
  *       (which closes old and shows new notifications on screen)
  *
  * @param status the current status of dunst
+ * @param time the current time
+ * @return true, if a deadline was due or a notification changed its queue
  */
-void queues_update(struct dunst_status status);
+bool queues_update(struct dunst_status status, gint64 time);
 
 /**
  * Calculate the distance to the next event, when an element in the
@@ -4,11 +4,137 @@
 
 #include <fnmatch.h>
 #include <glib.h>
+#include <string.h>
+#include <time.h>
 
 #include "dunst.h"
+#include "log.h"
+#include "utils.h"
 
 GSList *rules = NULL;
 
+/**
+ * The compiled rules, indexed by the fields, which most rules filter
+ * with an exact match. The lists contain the positions of the rules in
+ * ascending order.
+ */
+static struct {
+        GPtrArray *rules;       /**< all rules in the order of #rules */
+        GHashTable *appname;    /**< exact appname -> GArray of positions */
+        GHashTable *category;   /**< exact category -> GArray of positions */
+        GArray *unindexed;      /**< the positions of all other rules */
+        char *cacheable;        /**< the #rule_cacheable of each rule */
+        guint key_fields;       /**< the fields of the rule_cache keys */
+        GRegex *body_regex;     /**< the alternation of the combined body regexes */
+} rule_index;
+
+/**
+ * The result of scanning the body of the notification, to which
+ * rule_apply_all() currently applies the rules, with the combined body
+ * regex. The scan happens only when the first rule with a combined body
+ * regex gets evaluated.
+ */
+static struct {
+        const struct notification *n; /**< the notification, NULL outside of rule_apply_all() */
+        enum {
+                BODY_SCAN_PENDING,
+                BODY_SCAN_NONE,    /**< none of the combined regexes matches */
+                BODY_SCAN_SOME,    /**< some of them match, but it's unknown which */
+        } result;
+} body_scan;
+
+/**
+ * The properties of a notification a rule inspects or changes, the
+ * #rule_field bits and these
+ */
+#define RULE_TRANSIENT (1 << RULE_FIELD_COUNT)
+#define RULE_URGENCY   (1 << (RULE_FIELD_COUNT + 1))
+#define RULE_TEXT      ((1 << RULE_SUMMARY) | (1 << RULE_BODY))
+
+/**
+ * How the result of a rule can be cached
+ */
+enum rule_cacheable {
+        RULE_CACHE_RESULT, /**< the result only depends on the cache key */
+        RULE_CACHE_EVAL,   /**< the rule inspects the summary or the body */
+        RULE_CACHE_STOP,   /**< like #RULE_CACHE_EVAL, but changes the
+                                properties later rules inspect */
+};
+
+/**
+ * The maximum amount of cache entries. The cache starts over when it's
+ * full.
+ */
+#define RULE_CACHE_SIZE 1024
+
+/**
+ * Marks a rule in rule_cache_entry.rules, which has to be evaluated
+ */
+#define RULE_CACHE_EVAL_FLAG (1u << 31)
+
+/**
+ * The rules to apply for a combination of notification properties
+ * other than summary and body
+ */
+struct rule_cache_entry {
+        GArray *rules; /**< the positions of the matching rules and those to evaluate */
+        guint rest;    /**< the position from which on all candidates get
+                            evaluated, or G_MAXUINT */
+};
+
+static const char *rule_get_field(const struct notification *n, enum rule_field field);
+
+static struct {
+        GHashTable *entries; /**< key from rule_cache_key() -> #rule_cache_entry */
+        guint hits;
+        guint misses;
+} rule_cache;
+
+/**
+ * The counters of rule_apply_all() as a whole
+ */
+static struct rule_stats rules_stats;
+
+/**
+ * @return the time in nanoseconds. time_monotonic_now() is too coarse
+ * to time a single rule.
+ */
+static guint64 rule_stats_now(void)
+{
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (guint64) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * Check whether the rule should be applied to the notification and
+ * count the evaluation, while settings.profile_rules is enabled
+ */
+static bool rule_evaluate(struct rule *r, struct notification *n)
+{
+        if (!settings.profile_rules)
+                return rule_matches_notification(r, n);
+
+        guint64 start = rule_stats_now();
+        bool match = rule_matches_notification(r, n);
+        r->stats.time += rule_stats_now() - start;
+        r->stats.evaluations++;
+        return match;
+}
+
+/**
+ * Apply the rule, which matched, and count the match, while
+ * settings.profile_rules is enabled
+ */
+static void rule_apply_matched(struct rule *r, struct notification *n)
+{
+        if (settings.profile_rules) {
+                r->stats.matches++;
+                rules_stats.matches++;
+        }
+        rule_apply(r, n);
+}
+
 /*
  * Apply rule to notification.
  */
@@ -27,21 +153,21 @@ void rule_apply(struct rule *r, struct notification *n)
         if (r->markup != MARKUP_NULL)
                 n->markup = r->markup;
         if (r->new_icon) {
-                g_free(n->icon);
-                n->icon = g_strdup(r->new_icon);
+                string_release(n->icon);
+                n->icon = string_intern(r->new_icon);
                 g_clear_pointer(&n->raw_icon, rawimage_free);
         }
         if (r->fg) {
-                g_free(n->colors.fg);
-                n->colors.fg = g_strdup(r->fg);
+                string_release(n->colors.fg);
+                n->colors.fg = string_intern(r->fg);
         }
         if (r->bg) {
-                g_free(n->colors.bg);
-                n->colors.bg = g_strdup(r->bg);
+                string_release(n->colors.bg);
+                n->colors.bg = string_intern(r->bg);
         }
         if (r->fc) {
-                g_free(n->colors.frame);
-                n->colors.frame = g_strdup(r->fc);
+                string_release(n->colors.frame);
+                n->colors.frame = string_intern(r->fc);
         }
         if (r->format)
                 n->format = r->format;
@@ -53,17 +179,228 @@ void rule_apply(struct rule *r, struct notification *n)
         }
 }
 
+/**
+ * Iterates over the rules, which can match a notification, in their
+ * original order
+ */
+struct rule_candidates {
+        GArray *lists[3];
+        guint next[3];
+};
+
+/**
+ * Only the rules with the same appname or category and the unindexed
+ * ones can match. Their lists get merged to apply them in their original
+ * order. The rules don't change the appname or the category, so the
+ * candidates stay the same.
+ *
+ * @param first The position of the first rule to iterate over
+ */
+static void rule_candidates_init(struct rule_candidates *c, const struct notification *n, guint first)
+{
+        c->lists[0] = n->appname  ? g_hash_table_lookup(rule_index.appname, n->appname)   : NULL;
+        c->lists[1] = n->category ? g_hash_table_lookup(rule_index.category, n->category) : NULL;
+        c->lists[2] = rule_index.unindexed;
+
+        for (int i = 0; i < G_N_ELEMENTS(c->lists); i++) {
+                c->next[i] = 0;
+                while (c->lists[i] && c->next[i] < c->lists[i]->len
+                       && g_array_index(c->lists[i], guint, c->next[i]) < first)
+                        c->next[i]++;
+        }
+}
+
+static bool rule_candidates_next(struct rule_candidates *c, guint *pos)
+{
+        int list = -1;
+        *pos = G_MAXUINT;
+        for (int i = 0; i < G_N_ELEMENTS(c->lists); i++) {
+                if (c->lists[i] && c->next[i] < c->lists[i]->len
+                    && g_array_index(c->lists[i], guint, c->next[i]) < *pos) {
+                        list = i;
+                        *pos = g_array_index(c->lists[i], guint, c->next[i]);
+                }
+        }
+        if (list < 0)
+                return false;
+
+        c->next[list]++;
+        return true;
+}
+
+/**
+ * Evaluate and apply all candidates from position \p first on
+ */
+static void rule_apply_candidates(struct notification *n, guint first)
+{
+        struct rule_candidates c;
+        guint pos;
+
+        rule_candidates_init(&c, n, first);
+        while (rule_candidates_next(&c, &pos)) {
+                struct rule *r = g_ptr_array_index(rule_index.rules, pos);
+                if (rule_evaluate(r, n))
+                        rule_apply_matched(r, n);
+        }
+}
+
+/**
+ * Apply the rules and record their results in a new cache entry
+ */
+static struct rule_cache_entry *rule_apply_recorded(struct notification *n)
+{
+        struct rule_cache_entry *entry = g_malloc(sizeof(struct rule_cache_entry));
+        struct rule_candidates c;
+        guint pos;
+
+        entry->rules = g_array_new(false, false, sizeof(guint));
+        entry->rest = G_MAXUINT;
+
+        rule_candidates_init(&c, n, 0);
+        while (rule_candidates_next(&c, &pos)) {
+                struct rule *r = g_ptr_array_index(rule_index.rules, pos);
+
+                /* the results of the later rules depend on this one */
+                if (rule_index.cacheable[pos] == RULE_CACHE_STOP) {
+                        entry->rest = pos;
+                        rule_apply_candidates(n, pos);
+                        break;
+                }
+
+                bool match = rule_evaluate(r, n);
+                if (rule_index.cacheable[pos] == RULE_CACHE_EVAL) {
+                        guint eval = pos | RULE_CACHE_EVAL_FLAG;
+                        g_array_append_val(entry->rules, eval);
+                } else if (match) {
+                        g_array_append_val(entry->rules, pos);
+                }
+
+                if (match)
+                        rule_apply_matched(r, n);
+        }
+
+        return entry;
+}
+
+/**
+ * Apply the rules as recorded by rule_apply_recorded()
+ */
+static void rule_apply_cached(const struct rule_cache_entry *entry, struct notification *n)
+{
+        for (guint i = 0; i < entry->rules->len; i++) {
+                guint pos = g_array_index(entry->rules, guint, i);
+                struct rule *r = g_ptr_array_index(rule_index.rules, pos & ~RULE_CACHE_EVAL_FLAG);
+
+                if (!(pos & RULE_CACHE_EVAL_FLAG) || rule_evaluate(r, n))
+                        rule_apply_matched(r, n);
+        }
+
+        if (entry->rest != G_MAXUINT)
+                rule_apply_candidates(n, entry->rest);
+}
+
+static void rule_cache_entry_free(struct rule_cache_entry *entry)
+{
+        g_array_free(entry->rules, true);
+        g_free(entry);
+}
+
+/**
+ * Build the key of the properties, which any rule inspects, except
+ * for the summary and the body.
+ */
+static char *rule_cache_key(const struct notification *n)
+{
+        GString *key = g_string_new(NULL);
+
+        for (int i = 0; i < RULE_FIELD_COUNT; i++) {
+                if (!(rule_index.key_fields & (1 << i)))
+                        continue;
+
+                const char *value = rule_get_field(n, i);
+                if (value)
+                        g_string_append_printf(key, "%zu:%s|", strlen(value), value);
+                else
+                        g_string_append(key, "-|");
+        }
+        if (rule_index.key_fields & RULE_TRANSIENT)
+                g_string_append_printf(key, "%d|", n->transient);
+        if (rule_index.key_fields & RULE_URGENCY)
+                g_string_append_printf(key, "%d|", n->urgency);
+
+        return g_string_free(key, false);
+}
+
+static void rule_cache_log_stats(void)
+{
+        guint lookups = rule_cache.hits + rule_cache.misses;
+
+        LOG_D("Rule cache: %u lookups, %.1f%% hits, %u entries",
+              lookups,
+              lookups ? 100.0 * rule_cache.hits / lookups : 0.0,
+              rule_cache.entries ? g_hash_table_size(rule_cache.entries) : 0);
+}
+
+/**
+ * Check all rules if they match n and apply.
+ */
+static void rules_apply(struct notification *n)
+{
+        if (!rule_index.rules) {
+                for (GSList *iter = rules; iter; iter = iter->next) {
+                        struct rule *r = iter->data;
+                        if (rule_evaluate(r, n)) {
+                                rule_apply_matched(r, n);
+                        }
+                }
+                return;
+        }
+
+        body_scan.n = n;
+        body_scan.result = BODY_SCAN_PENDING;
+
+        char *key = rule_cache_key(n);
+        struct rule_cache_entry *entry = g_hash_table_lookup(rule_cache.entries, key);
+
+        if (entry) {
+                rule_cache.hits++;
+                rule_apply_cached(entry, n);
+                g_free(key);
+        } else {
+                rule_cache.misses++;
+                if (g_hash_table_size(rule_cache.entries) >= RULE_CACHE_SIZE) {
+                        rule_cache_log_stats();
+                        g_hash_table_remove_all(rule_cache.entries);
+                }
+                g_hash_table_insert(rule_cache.entries, key, rule_apply_recorded(n));
+        }
+
+        body_scan.n = NULL;
+
+        if ((rule_cache.hits + rule_cache.misses) % 1000 == 0)
+                rule_cache_log_stats();
+}
+
 /*
  * Check all rules if they match n and apply.
  */
 void rule_apply_all(struct notification *n)
 {
-        for (GSList *iter = rules; iter; iter = iter->next) {
-                struct rule *r = iter->data;
-                if (rule_matches_notification(r, n)) {
-                        rule_apply(r, n);
-                }
+        if (!settings.profile_rules) {
+                rules_apply(n);
+                return;
         }
+
+        guint64 start = rule_stats_now();
+        rules_apply(n);
+        rules_stats.time += rule_stats_now() - start;
+        rules_stats.evaluations++;
+}
+
+/* see rules.h */
+struct rule_stats rules_get_stats(void)
+{
+        return rules_stats;
 }
 
 /*
@@ -78,6 +415,12 @@ void rule_init(struct rule *r)
         r->icon = NULL;
         r->category = NULL;
         r->stack_tag = NULL;
+        r->appname_regex = NULL;
+        r->summary_regex = NULL;
+        r->body_regex = NULL;
+        r->icon_regex = NULL;
+        r->category_regex = NULL;
+        r->stack_tag_regex = NULL;
         r->msg_urgency = URG_NONE;
         r->timeout = -1;
         r->urgency = URG_NONE;
@@ -92,6 +435,338 @@ void rule_init(struct rule *r)
         r->fc = NULL;
         r->format = NULL;
         r->set_stack_tag = NULL;
+        r->compiled = false;
+        r->invalid = false;
+        r->body_regex_combined = false;
+        for (int i = 0; i < RULE_FIELD_COUNT; i++)
+                r->regexes[i] = NULL;
+        r->stats = (struct rule_stats) { 0 };
+}
+
+static const char *rule_get_glob(const struct rule *r, enum rule_field field)
+{
+        switch (field) {
+        case RULE_APPNAME:   return r->appname;
+        case RULE_SUMMARY:   return r->summary;
+        case RULE_BODY:      return r->body;
+        case RULE_ICON:      return r->icon;
+        case RULE_CATEGORY:  return r->category;
+        case RULE_STACK_TAG: return r->stack_tag;
+        default:             return NULL;
+        }
+}
+
+static const char *rule_get_regex(const struct rule *r, enum rule_field field)
+{
+        switch (field) {
+        case RULE_APPNAME:   return r->appname_regex;
+        case RULE_SUMMARY:   return r->summary_regex;
+        case RULE_BODY:      return r->body_regex;
+        case RULE_ICON:      return r->icon_regex;
+        case RULE_CATEGORY:  return r->category_regex;
+        case RULE_STACK_TAG: return r->stack_tag_regex;
+        default:             return NULL;
+        }
+}
+
+static const char *rule_get_field(const struct notification *n, enum rule_field field)
+{
+        switch (field) {
+        case RULE_APPNAME:   return n->appname;
+        case RULE_SUMMARY:   return n->summary;
+        case RULE_BODY:      return n->body;
+        case RULE_ICON:      return n->icon;
+        case RULE_CATEGORY:  return n->category;
+        case RULE_STACK_TAG: return n->stack_tag;
+        default:             return NULL;
+        }
+}
+
+/**
+ * Classify the glob by its wildcards. Only a leading and a trailing '*'
+ * get special treatment, any other wildcard or escape needs fnmatch().
+ */
+static void rule_pattern_compile(struct rule_pattern *p, const char *glob)
+{
+        if (!glob) {
+                p->kind = PATTERN_NONE;
+                return;
+        }
+
+        size_t len = strlen(glob);
+        bool leading = len > 0 && glob[0] == '*';
+        bool trailing = len > leading && glob[len - 1] == '*';
+
+        p->text = glob + leading;
+        p->len = len - leading - trailing;
+
+        if (strcspn(p->text, "*?[\\") < p->len) {
+                p->kind = PATTERN_GLOB;
+                p->text = glob;
+        } else if (leading) {
+                p->kind = trailing ? PATTERN_CONTAINS : PATTERN_SUFFIX;
+        } else {
+                p->kind = trailing ? PATTERN_PREFIX : PATTERN_EXACT;
+        }
+}
+
+static bool rule_pattern_matches(const struct rule_pattern *p, const char *str)
+{
+        if (p->kind == PATTERN_NONE)
+                return true;
+        if (!str)
+                return false;
+
+        size_t len;
+        switch (p->kind) {
+        case PATTERN_EXACT:
+                return STR_EQ(p->text, str);
+        case PATTERN_PREFIX:
+                return STRN_EQ(p->text, str, p->len);
+        case PATTERN_SUFFIX:
+                len = strlen(str);
+                return len >= p->len && memcmp(str + len - p->len, p->text, p->len) == 0;
+        case PATTERN_CONTAINS:
+                if (p->len == 0)
+                        return true;
+                for (const char *c = str; (c = strchr(c, p->text[0])); c++)
+                        if (STRN_EQ(c, p->text, p->len))
+                                return true;
+                return false;
+        default:
+                return !fnmatch(p->text, str, 0);
+        }
+}
+
+/**
+ * Match the regex of the rule for the field. A body regex, which is part
+ * of the combined alternation, can't match, if the alternation doesn't.
+ */
+static bool rule_regex_matches(const struct rule *r, enum rule_field field, const struct notification *n)
+{
+        const char *str = rule_get_field(n, field);
+        if (!str)
+                return false;
+
+        if (field == RULE_BODY && r->body_regex_combined && body_scan.n == n) {
+                if (body_scan.result == BODY_SCAN_PENDING)
+                        body_scan.result = g_regex_match(rule_index.body_regex, str, 0, NULL)
+                                         ? BODY_SCAN_SOME : BODY_SCAN_NONE;
+                if (body_scan.result == BODY_SCAN_NONE)
+                        return false;
+        }
+
+        return g_regex_match(r->regexes[field], str, 0, NULL);
+}
+
+/* see rules.h */
+void rule_compile(struct rule *r)
+{
+        r->invalid = false;
+        r->body_regex_combined = false;
+
+        for (int i = 0; i < RULE_FIELD_COUNT; i++) {
+                rule_pattern_compile(&r->patterns[i], rule_get_glob(r, i));
+
+                g_clear_pointer(&r->regexes[i], g_regex_unref);
+                const char *regex = rule_get_regex(r, i);
+                if (!regex)
+                        continue;
+
+                GError *err = NULL;
+                r->regexes[i] = g_regex_new(regex, G_REGEX_OPTIMIZE, 0, &err);
+                if (!r->regexes[i]) {
+                        LOG_W("Invalid regex in rule '%s', the rule won't match: %s",
+                              r->name ? r->name : "", err->message);
+                        g_error_free(err);
+                        r->invalid = true;
+                }
+        }
+
+        r->compiled = true;
+}
+
+/**
+ * @return the properties of a notification, which the rule inspects
+ */
+static guint rule_inspected(const struct rule *r)
+{
+        guint fields = 0;
+
+        for (int i = 0; i < RULE_FIELD_COUNT; i++)
+                if (r->patterns[i].kind != PATTERN_NONE || r->regexes[i])
+                        fields |= 1 << i;
+        if (r->match_transient != -1)
+                fields |= RULE_TRANSIENT;
+        if (r->msg_urgency != URG_NONE)
+                fields |= RULE_URGENCY;
+
+        return fields;
+}
+
+/**
+ * @return the properties of a notification, which the rule changes
+ */
+static guint rule_changed(const struct rule *r)
+{
+        return (r->new_icon              ? 1 << RULE_ICON      : 0)
+             | (r->set_stack_tag         ? 1 << RULE_STACK_TAG : 0)
+             | (r->set_transient != -1   ? RULE_TRANSIENT      : 0)
+             | (r->urgency != URG_NONE   ? RULE_URGENCY        : 0);
+}
+
+static void rule_index_add(GHashTable *index, const char *key, guint pos)
+{
+        GArray *list = g_hash_table_lookup(index, key);
+        if (!list) {
+                list = g_array_new(false, false, sizeof(guint));
+                g_hash_table_insert(index, (gpointer) key, list);
+        }
+        g_array_append_val(list, pos);
+}
+
+/**
+ * Check if the regex means the same as part of an alternation. It may
+ * not refer to groups by their number, as they get renumbered, and may
+ * not swallow the following alternatives like an unterminated `\Q`.
+ * Some harmless constructs like `(?-i)` get rejected, too.
+ */
+static bool rule_regex_is_combinable(const char *regex)
+{
+        for (const char *c = regex; *c; c++) {
+                if (c[0] == '\\') {
+                        if (c[1] && strchr("123456789g", c[1]))
+                                return false;
+                        if (c[1])
+                                c++;
+                } else if (c[0] == '(' && c[1] == '?' && c[2]
+                           && strchr("R0123456789+-", c[2])) {
+                        return false;
+                }
+        }
+
+        char *wrapped = g_strdup_printf("(?:%s)", regex);
+        GRegex *test = g_regex_new(wrapped, 0, 0, NULL);
+        g_free(wrapped);
+        if (!test)
+                return false;
+
+        g_regex_unref(test);
+        return true;
+}
+
+/**
+ * Combine the body regexes of the rules into one alternation. A match of
+ * the alternation doesn't tell, which of the regexes match, as only one
+ * alternative gets reported per position. But if it doesn't match, none
+ * of them does, which is the common case.
+ */
+static void rules_combine_body_regexes(void)
+{
+        GString *alternation = g_string_new(NULL);
+        GPtrArray *combined = g_ptr_array_new();
+
+        for (guint pos = 0; pos < rule_index.rules->len; pos++) {
+                struct rule *r = g_ptr_array_index(rule_index.rules, pos);
+                if (!r->regexes[RULE_BODY] || !rule_regex_is_combinable(r->body_regex))
+                        continue;
+
+                g_string_append_printf(alternation, "%s(?:%s)",
+                                       combined->len ? "|" : "", r->body_regex);
+                g_ptr_array_add(combined, r);
+        }
+
+        if (combined->len > 0) {
+                GError *err = NULL;
+                rule_index.body_regex = g_regex_new(alternation->str, G_REGEX_OPTIMIZE, 0, &err);
+                if (rule_index.body_regex) {
+                        for (guint i = 0; i < combined->len; i++)
+                                ((struct rule *) g_ptr_array_index(combined, i))->body_regex_combined = true;
+                        LOG_D("Combined %u body regexes", combined->len);
+                } else {
+                        LOG_W("Unable to combine the body regexes: %s", err->message);
+                        g_error_free(err);
+                }
+        }
+
+        g_ptr_array_free(combined, true);
+        g_string_free(alternation, true);
+}
+
+/* see rules.h */
+void rules_compile(void)
+{
+        if (rule_index.rules) {
+                g_ptr_array_free(rule_index.rules, true);
+                g_hash_table_unref(rule_index.appname);
+                g_hash_table_unref(rule_index.category);
+                g_array_free(rule_index.unindexed, true);
+                g_free(rule_index.cacheable);
+                g_clear_pointer(&rule_index.body_regex, g_regex_unref);
+        }
+
+        /* the cached results refer to the previous rules */
+        if (rule_cache.entries) {
+                rule_cache_log_stats();
+                g_hash_table_unref(rule_cache.entries);
+        }
+        rule_cache.entries = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                                   (GDestroyNotify) rule_cache_entry_free);
+        rule_cache.hits = 0;
+        rule_cache.misses = 0;
+
+        rule_index.rules = g_ptr_array_new();
+        rule_index.appname = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                   NULL, (GDestroyNotify) g_array_unref);
+        rule_index.category = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                    NULL, (GDestroyNotify) g_array_unref);
+        rule_index.unindexed = g_array_new(false, false, sizeof(guint));
+
+        guint by_appname = 0, by_category = 0;
+        for (GSList *iter = rules; iter; iter = iter->next) {
+                struct rule *r = iter->data;
+                guint pos = rule_index.rules->len;
+
+                rule_compile(r);
+                g_ptr_array_add(rule_index.rules, r);
+
+                if (r->patterns[RULE_APPNAME].kind == PATTERN_EXACT) {
+                        rule_index_add(rule_index.appname, r->appname, pos);
+                        by_appname++;
+                } else if (r->patterns[RULE_CATEGORY].kind == PATTERN_EXACT) {
+                        rule_index_add(rule_index.category, r->category, pos);
+                        by_category++;
+                } else {
+                        g_array_append_val(rule_index.unindexed, pos);
+                }
+        }
+
+        /* A rule on the summary or the body has to be evaluated every
+         * time. If it changes the properties later rules inspect, the
+         * results of the later rules can't be cached either. */
+        guint len = rule_index.rules->len;
+        guint inspected_later = 0;
+        rule_index.cacheable = g_malloc(len);
+        for (guint pos = len; pos-- > 0; ) {
+                struct rule *r = g_ptr_array_index(rule_index.rules, pos);
+                guint inspected = rule_inspected(r);
+
+                if (!(inspected & RULE_TEXT))
+                        rule_index.cacheable[pos] = RULE_CACHE_RESULT;
+                else if (rule_changed(r) & inspected_later)
+                        rule_index.cacheable[pos] = RULE_CACHE_STOP;
+                else
+                        rule_index.cacheable[pos] = RULE_CACHE_EVAL;
+
+                inspected_later |= inspected;
+        }
+        rule_index.key_fields = inspected_later & ~RULE_TEXT;
+
+        if (settings.combine_body_regexes)
+                rules_combine_body_regexes();
+
+        LOG_D("Compiled %u rules, %u indexed by appname, %u by category",
+              rule_index.rules->len, by_appname, by_category);
 }
 
 /*
@@ -99,13 +774,24 @@ void rule_init(struct rule *r)
  */
 bool rule_matches_notification(struct rule *r, struct notification *n)
 {
-        return   ( (!r->appname   || (n->appname   && !fnmatch(r->appname,   n->appname, 0)))
-                && (!r->summary   || (n->summary   && !fnmatch(r->summary,   n->summary, 0)))
-                && (!r->body      || (n->body      && !fnmatch(r->body,      n->body, 0)))
-                && (!r->icon      || (n->icon      && !fnmatch(r->icon,      n->icon, 0)))
-                && (!r->category  || (n->category  && !fnmatch(r->category,  n->category, 0)))
-                && (!r->stack_tag || (n->stack_tag && !fnmatch(r->stack_tag, n->stack_tag, 0)))
-                && (r->match_transient == -1 || (r->match_transient == n->transient))
-                && (r->msg_urgency == URG_NONE || r->msg_urgency == n->urgency));
+        if (!r->compiled)
+                rule_compile(r);
+        if (r->invalid)
+                return false;
+
+        if (r->match_transient != -1 && r->match_transient != n->transient)
+                return false;
+        if (r->msg_urgency != URG_NONE && r->msg_urgency != n->urgency)
+                return false;
+
+        for (int i = 0; i < RULE_FIELD_COUNT; i++)
+                if (!rule_pattern_matches(&r->patterns[i], rule_get_field(n, i)))
+                        return false;
+
+        for (int i = 0; i < RULE_FIELD_COUNT; i++)
+                if (r->regexes[i] && !rule_regex_matches(r, i, n))
+                        return false;
+
+        return true;
 }
 /* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -8,6 +8,51 @@
 #include "notification.h"
 #include "settings.h"
 
+/**
+ * The fields of a notification, which rules filter with globs
+ */
+enum rule_field {
+        RULE_APPNAME,
+        RULE_SUMMARY,
+        RULE_BODY,
+        RULE_ICON,
+        RULE_CATEGORY,
+        RULE_STACK_TAG,
+        RULE_FIELD_COUNT,
+};
+
+/**
+ * The cheapest way to match a glob
+ */
+enum rule_pattern_kind {
+        PATTERN_NONE,     /**< the field isn't filtered */
+        PATTERN_EXACT,    /**< `foo`, without any wildcards */
+        PATTERN_PREFIX,   /**< `foo*` */
+        PATTERN_SUFFIX,   /**< `*foo` */
+        PATTERN_CONTAINS, /**< `*foo*` */
+        PATTERN_GLOB,     /**< everything else, matched by fnmatch() */
+};
+
+/**
+ * A glob of a rule, classified by rule_compile()
+ */
+struct rule_pattern {
+        enum rule_pattern_kind kind;
+        const char *text; /**< the literal part or the whole glob for #PATTERN_GLOB */
+        size_t len;       /**< the length of the literal part */
+};
+
+/**
+ * The counters of a rule, which get only updated while
+ * settings.profile_rules is enabled
+ */
+struct rule_stats {
+        guint64 evaluations; /**< the calls of rule_matches_notification() */
+        guint64 matches;     /**< how often the rule got applied, including
+                                  the results from the cache */
+        guint64 time;        /**< the nanoseconds spent in rule_matches_notification() */
+};
+
 struct rule {
         char *name;
         /* filters */
@@ -17,6 +62,12 @@ struct rule {
         char *icon;
         char *category;
         char *stack_tag;
+        char *appname_regex;
+        char *summary_regex;
+        char *body_regex;
+        char *icon_regex;
+        char *category_regex;
+        char *stack_tag_regex;
         int msg_urgency;
 
         /* actions */
@@ -34,6 +85,15 @@ struct rule {
         const char *script;
         enum behavior_fullscreen fullscreen;
         char *set_stack_tag;
+
+        /* compiled filters */
+        bool compiled;
+        bool invalid;            /**< a regex doesn't compile, the rule never matches */
+        bool body_regex_combined; /**< the body regex is part of the combined alternation */
+        struct rule_pattern patterns[RULE_FIELD_COUNT];
+        GRegex *regexes[RULE_FIELD_COUNT];
+
+        struct rule_stats stats;
 };
 
 extern GSList *rules;
@@ -43,5 +103,37 @@ void rule_apply(struct rule *r, struct notification *n);
 void rule_apply_all(struct notification *n);
 bool rule_matches_notification(struct rule *r, struct notification *n);
 
+/**
+ * Classify the globs of the rule, so rule_matches_notification() can
+ * match each of them with a specialized matcher, and compile its regexes.
+ *
+ * The rule has to be compiled again after its globs or regexes have
+ * changed.
+ * rule_matches_notification() compiles rules, which aren't yet.
+ */
+void rule_compile(struct rule *r);
+
+/**
+ * Compile all rules and index them by their exact appname and category,
+ * so rule_apply_all() only has to evaluate the rules, which can match.
+ *
+ * With settings.combine_body_regexes, the body regexes of all rules are
+ * combined into one alternation, so a single scan of the body rules out
+ * all of them at once.
+ *
+ * Has to be called again after the list of rules has changed. Until the
+ * first call, rule_apply_all() evaluates every rule.
+ */
+void rules_compile(void);
+
+/**
+ * Get the counters of rule_apply_all() as a whole, while
+ * settings.profile_rules is enabled.
+ *
+ * @return the calls of rule_apply_all() as evaluations, the amount of
+ * rules applied by them as matches and the nanoseconds spent in them.
+ */
+struct rule_stats rules_get_stats(void);
+
 #endif
 /* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -180,6 +180,12 @@ void load_settings(char *cmdline_config_path)
                 ""
         );
 
+        settings.combine_body_regexes = option_get_bool(
+                "experimental",
+                "combine_body_regexes", NULL, false,
+                ""
+        );
+
         settings.force_xinerama = option_get_bool(
                 "global",
                 "force_xinerama", "-force_xinerama", false,
@@ -228,6 +234,7 @@ void load_settings(char *cmdline_config_path)
                 "format", "-format", defaults.format,
                 "The format template for the notifications"
         );
+        notification_format_compile(settings.format);
 
         settings.sort = option_get_bool(
                 "global",
@@ -460,6 +467,17 @@ void load_settings(char *cmdline_config_path)
                 "print notification on startup"
         );
 
+        settings.max_fps = option_get_int(
+                "global",
+                "max_fps", "-max_fps", defaults.max_fps,
+                "Maximum amount of redraws per second (0 for no limit)"
+        );
+
+        if (settings.max_fps < 0) {
+                LOG_W("Setting max_fps to 0 (no limit), as it cannot be negative.");
+                settings.max_fps = 0;
+        }
+
         settings.dmenu = option_get_path(
                 "global",
                 "dmenu", "-dmenu", defaults.dmenu,
@@ -519,6 +537,17 @@ void load_settings(char *cmdline_config_path)
                 "Scale larger icons down to this size, set to 0 to disable"
         );
 
+        settings.icon_cache_size = option_get_int(
+                "global",
+                "icon_cache_size", "-icon_cache_size", defaults.icon_cache_size,
+                "Memory in KiB to keep decoded icons in, set to 0 to disable"
+        );
+
+        if (settings.icon_cache_size < 0) {
+                LOG_W("Setting icon_cache_size to 0 (disabled), as it cannot be negative.");
+                settings.icon_cache_size = 0;
+        }
+
         // If the deprecated icon_folders option is used,
         // read it and generate its usage string.
         if (ini_is_set("global", "icon_folders") || cmdline_is_set("-icon_folders")) {
@@ -752,6 +781,12 @@ void load_settings(char *cmdline_config_path)
                 "Always run rule-defined scripts, even if the notification is suppressed with format = \"\"."
         );
 
+        settings.profile_rules = option_get_bool(
+                "global",
+                "profile_rules", "-profile_rules", false,
+                "Count the evaluations, the matches and the time spent for each rule"
+        );
+
         /* push hardcoded default rules into rules list */
         for (int i = 0; i < G_N_ELEMENTS(default_rules); i++) {
                 rules = g_slist_insert(rules, &(default_rules[i]), -1);
@@ -793,6 +828,12 @@ void load_settings(char *cmdline_config_path)
                 r->icon = ini_get_string(cur_section, "icon", r->icon);
                 r->category = ini_get_string(cur_section, "category", r->category);
                 r->stack_tag = ini_get_string(cur_section, "stack_tag", r->stack_tag);
+                r->appname_regex = ini_get_string(cur_section, "appname_regex", r->appname_regex);
+                r->summary_regex = ini_get_string(cur_section, "summary_regex", r->summary_regex);
+                r->body_regex = ini_get_string(cur_section, "body_regex", r->body_regex);
+                r->icon_regex = ini_get_string(cur_section, "icon_regex", r->icon_regex);
+                r->category_regex = ini_get_string(cur_section, "category_regex", r->category_regex);
+                r->stack_tag_regex = ini_get_string(cur_section, "stack_tag_regex", r->stack_tag_regex);
                 r->timeout = ini_get_time(cur_section, "timeout", r->timeout);
 
                 {
@@ -813,6 +854,8 @@ void load_settings(char *cmdline_config_path)
                 r->bg = ini_get_string(cur_section, "background", r->bg);
                 r->fc = ini_get_string(cur_section, "frame_color", r->fc);
                 r->format = ini_get_string(cur_section, "format", r->format);
+                if (r->format)
+                        notification_format_compile(r->format);
                 r->new_icon = ini_get_string(cur_section, "new_icon", r->new_icon);
                 r->history_ignore = ini_get_bool(cur_section, "history_ignore", r->history_ignore);
                 r->match_transient = ini_get_bool(cur_section, "match_transient", r->match_transient);
@@ -830,6 +873,8 @@ void load_settings(char *cmdline_config_path)
                 r->set_stack_tag = ini_get_string(cur_section, "set_stack_tag", r->set_stack_tag);
         }
 
+        rules_compile();
+
 #ifndef STATIC_CONFIG
         if (config_file) {
                 fclose(config_file);
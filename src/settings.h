@@ -31,6 +31,7 @@ struct settings {
         bool print_notifications;
         bool per_monitor_dpi;
         bool repopup_on_idle;
+        bool combine_body_regexes;
         enum markup_mode markup;
         bool stack_duplicates;
         bool hide_duplicate_count;
@@ -67,6 +68,7 @@ struct settings {
         int frame_width;
         char *frame_color;
         int startup_notification;
+        int max_fps;
         int monitor;
         char *dmenu;
         char **dmenu_cmd;
@@ -74,9 +76,11 @@ struct settings {
         char **browser_cmd;
         enum icon_position icon_position;
         int max_icon_size;
+        int icon_cache_size;
         char *icon_path;
         enum follow_mode f_mode;
         bool always_run_script;
+        bool profile_rules;
         struct keyboard_shortcut close_ks;
         struct keyboard_shortcut close_all_ks;
         struct keyboard_shortcut history_ks;
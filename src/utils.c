@@ -191,6 +191,75 @@ gint64 string_to_time(const char *string)
                 return 0;
 }
 
+/**
+ * The interned strings, each mapped to its reference count. The strings
+ * get released from the threads, which drop the last reference to a
+ * notification.
+ */
+static struct {
+        GHashTable *strings;
+        GMutex lock;
+} interned;
+
+/* see utils.h */
+char *string_intern(const char *str)
+{
+        if (!str)
+                return NULL;
+
+        gpointer shared, refs;
+
+        g_mutex_lock(&interned.lock);
+        if (!interned.strings)
+                interned.strings = g_hash_table_new(g_str_hash, g_str_equal);
+
+        if (g_hash_table_lookup_extended(interned.strings, str, &shared, &refs)) {
+                refs = GUINT_TO_POINTER(GPOINTER_TO_UINT(refs) + 1);
+        } else {
+                shared = g_strdup(str);
+                refs = GUINT_TO_POINTER(1);
+        }
+        g_hash_table_insert(interned.strings, shared, refs);
+        g_mutex_unlock(&interned.lock);
+
+        return shared;
+}
+
+/* see utils.h */
+void string_release(char *str)
+{
+        if (!str)
+                return;
+
+        gpointer shared = NULL, refs = NULL;
+
+        g_mutex_lock(&interned.lock);
+        if (interned.strings
+            && g_hash_table_lookup_extended(interned.strings, str, &shared, &refs)
+            && shared == str) {
+                if (GPOINTER_TO_UINT(refs) > 1)
+                        g_hash_table_insert(interned.strings, shared,
+                                            GUINT_TO_POINTER(GPOINTER_TO_UINT(refs) - 1));
+                else
+                        g_hash_table_remove(interned.strings, shared);
+        }
+        g_mutex_unlock(&interned.lock);
+
+        /* either the last reference or a string, which isn't interned */
+        if (shared != str || GPOINTER_TO_UINT(refs) == 1)
+                g_free(str);
+}
+
+/* see utils.h */
+guint string_interned_count(void)
+{
+        g_mutex_lock(&interned.lock);
+        guint count = interned.strings ? g_hash_table_size(interned.strings) : 0;
+        g_mutex_unlock(&interned.lock);
+
+        return count;
+}
+
 /* see utils.h */
 gint64 time_monotonic_now(void)
 {
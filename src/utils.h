@@ -98,6 +98,32 @@ char *string_to_path(char *string);
  */
 gint64 string_to_time(const char *string);
 
+/**
+ * Get the shared copy of a string. All equal strings share the same copy,
+ * which gets freed after the last reference to it got released.
+ *
+ * Meant for the strings, of which many notifications carry the same
+ * value, like the appname or the colors.
+ *
+ * @param str (nullable) The string to intern
+ * @returns (nullable) A new reference to the shared copy. It must not be
+ * modified. Release it with string_release().
+ */
+char *string_intern(const char *str);
+
+/**
+ * Release a reference to a string from string_intern(). Strings, which
+ * didn't come from string_intern(), get freed with `g_free`.
+ *
+ * @param str (nullable) The string to release
+ */
+void string_release(char *str);
+
+/**
+ * @returns The amount of distinct strings, which are currently interned
+ */
+guint string_interned_count(void);
+
 /**
  * Get the current monotonic time. In contrast to `g_get_monotonic_time`,
  * this function respects the real monotonic time of the system and
@@ -27,6 +27,9 @@ bool dunst_follow_errored = false;
 
 int randr_event_base = 0;
 
+/* the window, which has the focus according to the window manager */
+static Window active_window = None;
+
 static int randr_major_version = 0;
 static int randr_minor_version = 0;
 
@@ -195,7 +198,7 @@ void screen_update_fallback(void)
 /* see screen.h */
 bool have_fullscreen_window(void)
 {
-        return window_is_fullscreen(get_focused_window());
+        return window_is_fullscreen(active_window);
 }
 
 /**
@@ -224,11 +227,6 @@ bool window_is_fullscreen(Window window)
         if (!window)
                 return false;
 
-        Atom has_wm_state = XInternAtom(xctx.dpy, "_NET_WM_STATE", True);
-        if (has_wm_state == None){
-                return false;
-        }
-
         XFlush(xctx.dpy);
         XSetErrorHandler(XErrorHandlerFullscreen);
 
@@ -240,7 +238,7 @@ bool window_is_fullscreen(Window window)
         int result = XGetWindowProperty(
                         xctx.dpy,
                         window,
-                        has_wm_state,
+                        xctx.atoms[NET_WM_STATE],
                         0,                     /* long_offset */
                         sizeof(window),        /* long_length */
                         false,                 /* delete */
@@ -254,17 +252,13 @@ bool window_is_fullscreen(Window window)
         XFlush(xctx.dpy);
         XSync(xctx.dpy, false);
         XSetErrorHandler(NULL);
+        xctx.round_trips += 2;
 
         if (result == Success) {
                 for(int i = 0; i < n_items; i++) {
-                        char *atom = XGetAtomName(xctx.dpy, ((Atom*)prop_to_return)[i]);
-
-                        if (atom) {
-                                if(STR_EQ("_NET_WM_STATE_FULLSCREEN", atom))
-                                        fs = true;
-                                XFree(atom);
-                                if(fs)
-                                        break;
+                        if (((Atom*)prop_to_return)[i] == xctx.atoms[NET_WM_STATE_FULLSCREEN]) {
+                                fs = true;
+                                break;
                         }
                 }
         }
@@ -314,11 +308,12 @@ struct screen_info *get_active_screen(void)
                                       &dummy,
                                       &dummy,
                                       &dummy_ui);
+                        xctx.round_trips++;
                 }
 
                 if (settings.f_mode == FOLLOW_KEYBOARD) {
 
-                        Window focused = get_focused_window();
+                        Window focused = active_window;
 
                         if (focused == 0) {
                                 /* something went wrong. Fall back to default */
@@ -329,6 +324,7 @@ struct screen_info *get_active_screen(void)
                         Window child_return;
                         XTranslateCoordinates(xctx.dpy, focused, root,
                                         0, 0, &x, &y, &child_return);
+                        xctx.round_trips++;
                 }
 
                 for (int i = 0; i < screens_len; i++) {
@@ -376,12 +372,10 @@ static Window get_focused_window(void)
         unsigned long nitems, bytes_after;
         unsigned char *prop_return = NULL;
         Window root = RootWindow(xctx.dpy, DefaultScreen(xctx.dpy));
-        Atom netactivewindow =
-            XInternAtom(xctx.dpy, "_NET_ACTIVE_WINDOW", false);
 
         XGetWindowProperty(xctx.dpy,
                            root,
-                           netactivewindow,
+                           xctx.atoms[NET_ACTIVE_WINDOW],
                            0L,
                            sizeof(Window),
                            false,
@@ -391,6 +385,7 @@ static Window get_focused_window(void)
                            &nitems,
                            &bytes_after,
                            &prop_return);
+        xctx.round_trips++;
         if (prop_return) {
                 focused = *(Window *)prop_return;
                 XFree(prop_return);
@@ -399,6 +394,38 @@ static Window get_focused_window(void)
         return focused;
 }
 
+/* see screen.h */
+void active_window_update(void)
+{
+        Window focused = get_focused_window();
+        Window root = RootWindow(xctx.dpy, DefaultScreen(xctx.dpy));
+
+        if (focused == active_window)
+                return;
+
+        /* The windows may be gone already */
+        XFlush(xctx.dpy);
+        XSetErrorHandler(XErrorHandlerFullscreen);
+
+        /* Never touch the root's event mask, we're listening there, too */
+        if (active_window && active_window != root)
+                XSelectInput(xctx.dpy, active_window, NoEventMask);
+        if (focused && focused != root)
+                XSelectInput(xctx.dpy, focused, PropertyChangeMask);
+
+        XSync(xctx.dpy, false);
+        XSetErrorHandler(NULL);
+
+        LOG_D("Active window changed: 0x%lx", focused);
+        active_window = focused;
+}
+
+/* see screen.h */
+bool is_active_window(Window window)
+{
+        return window && window == active_window;
+}
+
 static void x_follow_setup_error_handler(void)
 {
         dunst_follow_errored = false;
@@ -412,6 +439,7 @@ static int x_follow_tear_down_error_handler(void)
         XFlush(xctx.dpy);
         XSync(xctx.dpy, false);
         XSetErrorHandler(NULL);
+        xctx.round_trips++;
         return dunst_follow_errored;
 }
 
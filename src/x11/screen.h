@@ -23,11 +23,24 @@ struct screen_info *get_active_screen(void);
 double get_dpi_for_screen(struct screen_info *scr);
 
 /**
- * Find the currently focused window and check if it's in
- * fullscreen mode
+ * Follow the window manager's _NET_ACTIVE_WINDOW to the currently
+ * focused window and listen to its property changes instead of the
+ * previous one's.
+ *
+ * Call this initially and whenever _NET_ACTIVE_WINDOW changed.
+ */
+void active_window_update(void);
+
+/**
+ * Check if the given window is the one tracked by active_window_update()
+ */
+bool is_active_window(Window window);
+
+/**
+ * Check if the focused window is in fullscreen mode
  *
  * @see window_is_fullscreen()
- * @see get_focused_window()
+ * @see active_window_update()
  *
  * @return `true` if the focused window is in fullscreen mode
  */
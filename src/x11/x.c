@@ -4,6 +4,7 @@
 #include <assert.h>
 #include <cairo.h>
 #include <cairo-xlib.h>
+#include <errno.h>
 #include <glib-object.h>
 #include <locale.h>
 #include <math.h>
@@ -11,8 +12,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
 #include <unistd.h>
 #include <X11/extensions/shape.h>
+#include <X11/extensions/sync.h>
+#include <X11/extensions/XShm.h>
 #include <X11/Xatom.h>
 #include <X11/X.h>
 #include <X11/XKBlib.h>
@@ -40,9 +45,12 @@ struct window_x11 {
         cairo_surface_t *root_surface;
         cairo_t *c_ctx;
         GSource *esrc;
+        GC gc;
         int cur_screen;
         bool visible;
         struct dimensions dim;
+        struct dimensions shape; /**< size and radius of the current shape mask */
+        struct shm_buffer *shm[2]; /**< presented alternately, while the server reads the other one */
 };
 
 struct x11_source {
@@ -50,10 +58,43 @@ struct x11_source {
         struct window_x11 *win;
 };
 
+/* An image in a shared memory segment, which is attached to the X server */
+struct shm_buffer {
+        XShmSegmentInfo info;
+        XImage *img;
+        unsigned int pending; /**< XShmPutImage requests, which the server hasn't completed */
+};
+
+/* The attached buffers, to match ShmCompletion events to them */
+static GSList *shm_buffers = NULL;
+
+/* Alarms on the XSync extension's IDLETIME counter, which report
+ * crossing the idle_threshold in both directions */
+struct idle_tracker {
+        XSyncCounter counter;   /**< IDLETIME, or None if not available */
+        XSyncAlarm idle;        /**< fires after idle_threshold without input */
+        XSyncAlarm active;      /**< fires on the first input after that */
+        int event_base;
+        bool is_idle;
+};
+
+static struct idle_tracker idle = { None };
+
 struct x_context xctx;
-bool dunst_grab_errored = false;
 
-static bool fullscreen_last = false;
+static const char *atom_names[X_ATOM_COUNT] = {
+        [NET_ACTIVE_WINDOW]               = "_NET_ACTIVE_WINDOW",
+        [NET_WM_NAME]                     = "_NET_WM_NAME",
+        [NET_WM_STATE]                    = "_NET_WM_STATE",
+        [NET_WM_STATE_ABOVE]              = "_NET_WM_STATE_ABOVE",
+        [NET_WM_STATE_FULLSCREEN]         = "_NET_WM_STATE_FULLSCREEN",
+        [NET_WM_WINDOW_OPACITY]           = "_NET_WM_WINDOW_OPACITY",
+        [NET_WM_WINDOW_TYPE]              = "_NET_WM_WINDOW_TYPE",
+        [NET_WM_WINDOW_TYPE_NOTIFICATION] = "_NET_WM_WINDOW_TYPE_NOTIFICATION",
+        [NET_WM_WINDOW_TYPE_UTILITY]      = "_NET_WM_WINDOW_TYPE_UTILITY",
+        [UTF8_STRING]                     = "UTF8_STRING",
+};
+bool dunst_grab_errored = false;
 
 static void x_shortcut_init(struct keyboard_shortcut *ks);
 static int x_shortcut_grab(struct keyboard_shortcut *ks);
@@ -63,6 +104,8 @@ static void x_shortcut_setup_error_handler(void);
 static int x_shortcut_tear_down_error_handler(void);
 static void setopacity(Window win, unsigned long opacity);
 static void x_handle_click(XEvent ev);
+static bool x_idle_check_event(XEvent *ev);
+static bool x_shm_check_event(XEvent *ev);
 
 static void x_win_move(struct window_x11 *win, int x, int y, int width, int height)
 {
@@ -89,6 +132,13 @@ static void x_win_round_corners(struct window_x11 *win, const int rad)
         const int dia = 2 * rad;
         const int degrees = 64; // the factor to convert degrees to XFillArc's angle param
 
+        /* The shape is a property of the window and stays until it
+         * gets replaced, so only rebuild it, if it would look different */
+        if (   win->shape.w == width
+            && win->shape.h == height
+            && win->shape.corner_radius == rad)
+                return;
+
         Pixmap mask = XCreatePixmap(xctx.dpy, win->xwin, width, height, 1);
         XGCValues xgcv;
 
@@ -147,16 +197,256 @@ static void x_win_round_corners(struct window_x11 *win, const int rad)
 
         XShapeSelectInput(xctx.dpy,
                 win->xwin, ShapeNotifyMask);
+
+        win->shape.w = width;
+        win->shape.h = height;
+        win->shape.corner_radius = rad;
+}
+
+/*
+ * Error handler for attaching a shared memory segment. The attach
+ * fails with BadAccess, if the server can't access our memory.
+ */
+static int ShmXErrorHandler(Display *display, XErrorEvent *e)
+{
+        dunst_grab_errored = true;
+        char err_buf[BUFSIZ];
+        XGetErrorText(display, e->error_code, err_buf, BUFSIZ);
+        LOG_D("XShmAttach failed: %s", err_buf);
+
+        return 0;
+}
+
+/*
+ * XIfEvent() predicate, matching the ShmCompletion events of the buffer arg.
+ */
+static Bool x_shm_is_completion(Display *dpy, XEvent *ev, XPointer arg)
+{
+        const struct shm_buffer *buf = (const struct shm_buffer *) arg;
+
+        return ev->type == xctx.shm_completion
+            && ((XShmCompletionEvent *) ev)->shmseg == buf->info.shmseg;
+}
+
+static void shm_buffer_free(void *data)
+{
+        struct shm_buffer *buf = data;
+
+        if (buf->info.shmaddr != (char*) -1) {
+                /* The server handles the detach after the pending puts */
+                XShmDetach(xctx.dpy, &buf->info);
+                XSync(xctx.dpy, false);
+                shmdt(buf->info.shmaddr);
+
+                /* Drop the completions, which can't be matched anymore */
+                XEvent ev;
+                while (buf->pending > 0
+                       && XCheckIfEvent(xctx.dpy, &ev, x_shm_is_completion, (XPointer) buf))
+                        buf->pending--;
+        }
+        shm_buffers = g_slist_remove(shm_buffers, buf);
+        /* The data doesn't belong to Xlib, so it must not free it */
+        buf->img->data = NULL;
+        XDestroyImage(buf->img);
+        g_free(buf);
 }
 
-void x_display_surface(cairo_surface_t *srf, struct window_x11 *win, const struct dimensions *dim)
+/*
+ * Allocate a shared memory image of the given size, which has the same
+ * pixel layout as cairo's ARGB32.
+ *
+ * Returns NULL if the visual's pixel format doesn't match cairo's
+ * ARGB32 or the segment can't be created.
+ */
+static struct shm_buffer *shm_buffer_new(int width, int height)
+{
+        int scr = DefaultScreen(xctx.dpy);
+        Visual *visual = DefaultVisual(xctx.dpy, scr);
+        struct shm_buffer *buf = g_malloc0(sizeof(struct shm_buffer));
+
+        buf->info.shmid = -1;
+        buf->info.shmaddr = (char*) -1;
+        buf->img = XShmCreateImage(xctx.dpy, visual, DefaultDepth(xctx.dpy, scr),
+                                   ZPixmap, NULL, &buf->info, width, height);
+        if (!buf->img) {
+                g_free(buf);
+                return NULL;
+        }
+
+        int native = G_BYTE_ORDER == G_LITTLE_ENDIAN ? LSBFirst : MSBFirst;
+        if (   buf->img->bits_per_pixel != 32
+            || buf->img->byte_order != native
+            || buf->img->red_mask   != 0xff0000
+            || buf->img->green_mask != 0x00ff00
+            || buf->img->blue_mask  != 0x0000ff) {
+                LOG_I("The visual's pixel format is not supported by the MIT-SHM path, falling back.");
+                xctx.shm = false;
+                shm_buffer_free(buf);
+                return NULL;
+        }
+
+        buf->info.shmid = shmget(IPC_PRIVATE, buf->img->bytes_per_line * height, IPC_CREAT | 0600);
+        if (buf->info.shmid < 0) {
+                LOG_W("Cannot create shared memory segment: %s", strerror(errno));
+                shm_buffer_free(buf);
+                return NULL;
+        }
+
+        buf->info.shmaddr = buf->img->data = shmat(buf->info.shmid, NULL, 0);
+        buf->info.readOnly = true;
+        if (buf->info.shmaddr == (char*) -1) {
+                LOG_W("Cannot attach shared memory segment: %s", strerror(errno));
+                shmctl(buf->info.shmid, IPC_RMID, NULL);
+                shm_buffer_free(buf);
+                return NULL;
+        }
+
+        dunst_grab_errored = false;
+        XSync(xctx.dpy, false);
+        XErrorHandler old = XSetErrorHandler(ShmXErrorHandler);
+        Status attached = XShmAttach(xctx.dpy, &buf->info);
+        XSync(xctx.dpy, false);
+        XSetErrorHandler(old);
+
+        /* Both sides are attached now (or never will be), so the segment
+         * can get marked for removal. It vanishes after both detached. */
+        shmctl(buf->info.shmid, IPC_RMID, NULL);
+
+        if (!attached || dunst_grab_errored) {
+                /* Most likely a remote display, don't try again */
+                LOG_I("The X server can't access our shared memory, falling back.");
+                xctx.shm = false;
+                shmdt(buf->info.shmaddr);
+                buf->info.shmaddr = (char*) -1;
+                shm_buffer_free(buf);
+                return NULL;
+        }
+
+        shm_buffers = g_slist_prepend(shm_buffers, buf);
+        return buf;
+}
+
+/*
+ * Get a shared memory buffer of at least the given size, which the
+ * server doesn't read from anymore.
+ *
+ * Returns NULL if both buffers are still busy or MIT-SHM isn't usable.
+ */
+static struct shm_buffer *x_win_get_shm(struct window_x11 *win, int width, int height)
+{
+        for (int i = 0; i < G_N_ELEMENTS(win->shm); i++) {
+                struct shm_buffer *buf = win->shm[i];
+
+                if (buf && buf->pending > 0)
+                        continue;
+
+                if (buf && (buf->img->width < width || buf->img->height < height))
+                        g_clear_pointer(&win->shm[i], shm_buffer_free);
+
+                if (!win->shm[i])
+                        win->shm[i] = shm_buffer_new(width, height);
+
+                return win->shm[i];
+        }
+
+        LOG_D("Both shared memory buffers are busy, falling back to xlib");
+        return NULL;
+}
+
+/*
+ * Copy the given rectangle of the surface into the shared memory image
+ * and from there into the window.
+ *
+ * The server reads the pixels asynchronously and reports with a
+ * ShmCompletion event, when it's done.
+ */
+static void x_win_put_shm(struct window_x11 *win, struct shm_buffer *buf, cairo_surface_t *srf, const cairo_rectangle_int_t *rect)
+{
+        const unsigned char *src = cairo_image_surface_get_data(srf);
+        int stride = cairo_image_surface_get_stride(srf);
+
+        for (int y = rect->y; y < rect->y + rect->height; y++)
+                memcpy(buf->img->data + y * buf->img->bytes_per_line + rect->x * 4,
+                       src + y * stride + rect->x * 4,
+                       rect->width * 4);
+
+        XShmPutImage(xctx.dpy, win->xwin, win->gc, buf->img,
+                     rect->x, rect->y, rect->x, rect->y,
+                     rect->width, rect->height, true);
+        buf->pending++;
+}
+
+/*
+ * Count a ShmCompletion event for the buffer it belongs to.
+ *
+ * Returns true if the event was a ShmCompletion event.
+ */
+static bool x_shm_check_event(XEvent *ev)
+{
+        if (xctx.shm_completion == 0 || ev->type != xctx.shm_completion)
+                return false;
+
+        ShmSeg seg = ((XShmCompletionEvent *) ev)->shmseg;
+        for (GSList *iter = shm_buffers; iter; iter = iter->next) {
+                struct shm_buffer *buf = iter->data;
+                if (buf->info.shmseg == seg && buf->pending > 0) {
+                        buf->pending--;
+                        break;
+                }
+        }
+
+        return true;
+}
+
+/* see x.h */
+void x_display_surface(cairo_surface_t *srf, struct window_x11 *win, const struct dimensions *dim, const cairo_region_t *damage)
 {
         x_win_move(win, dim->x, dim->y, dim->w, dim->h);
         cairo_xlib_surface_set_size(win->root_surface, dim->w, dim->h);
 
+        if (damage && cairo_region_is_empty(damage)) {
+                XFlush(xctx.dpy);
+                return;
+        }
+
+        int width = cairo_image_surface_get_width(srf);
+        int height = cairo_image_surface_get_height(srf);
+        struct shm_buffer *buf = xctx.shm ? x_win_get_shm(win, width, height) : NULL;
+        if (buf) {
+                cairo_rectangle_int_t full = { 0, 0, width, height };
+                cairo_region_t *area = damage ? cairo_region_copy(damage)
+                                              : cairo_region_create_rectangle(&full);
+                cairo_region_intersect_rectangle(area, &full);
+
+                cairo_surface_flush(srf);
+                for (int i = 0; i < cairo_region_num_rectangles(area); i++) {
+                        cairo_rectangle_int_t rect;
+                        cairo_region_get_rectangle(area, i, &rect);
+                        x_win_put_shm(win, buf, srf, &rect);
+                }
+                cairo_region_destroy(area);
+
+                if (settings.corner_radius != 0)
+                        x_win_round_corners(win, dim->corner_radius);
+
+                XFlush(xctx.dpy);
+                return;
+        }
+
+        cairo_save(win->c_ctx);
+        if (damage) {
+                for (int i = 0; i < cairo_region_num_rectangles(damage); i++) {
+                        cairo_rectangle_int_t rect;
+                        cairo_region_get_rectangle(damage, i, &rect);
+                        cairo_rectangle(win->c_ctx, rect.x, rect.y, rect.width, rect.height);
+                }
+                cairo_clip(win->c_ctx);
+        }
+
         cairo_set_source_surface(win->c_ctx, srf, 0, 0);
         cairo_paint(win->c_ctx);
         cairo_show_page(win->c_ctx);
+        cairo_restore(win->c_ctx);
 
         if (settings.corner_radius != 0)
                 x_win_round_corners(win, dim->corner_radius);
@@ -177,11 +467,9 @@ cairo_t* x_win_get_context(struct window_x11 *win)
 
 static void setopacity(Window win, unsigned long opacity)
 {
-        Atom _NET_WM_WINDOW_OPACITY =
-            XInternAtom(xctx.dpy, "_NET_WM_WINDOW_OPACITY", false);
         XChangeProperty(xctx.dpy,
                         win,
-                        _NET_WM_WINDOW_OPACITY,
+                        xctx.atoms[NET_WM_WINDOW_OPACITY],
                         XA_CARDINAL,
                         32,
                         PropModeReplace,
@@ -253,6 +541,20 @@ gboolean x_mainloop_fd_prepare(GSource *source, gint *timeout)
         return false;
 }
 
+/*
+ * Update the cached fullscreen state from the active window and wake up
+ * dunst, if it changed.
+ */
+static void x_fullscreen_update(void)
+{
+        bool fullscreen = have_fullscreen_window();
+
+        if (fullscreen != dunst_status_get().fullscreen) {
+                dunst_status(S_FULLSCREEN, fullscreen);
+                wake_up();
+        }
+}
+
 /*
  * Helper function to use glib's mainloop mechanic
  * with Xlib
@@ -268,8 +570,8 @@ gboolean x_mainloop_fd_check(GSource *source)
 gboolean x_mainloop_fd_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
 {
         struct window_x11 *win = ((struct x11_source*) source)->win;
+        Window root = RootWindow(xctx.dpy, DefaultScreen(xctx.dpy));
 
-        bool fullscreen_now;
         struct screen_info *scr;
         XEvent ev;
         unsigned int state;
@@ -280,6 +582,7 @@ gboolean x_mainloop_fd_dispatch(GSource *source, GSourceFunc callback, gpointer
                 case Expose:
                         LOG_D("XEvent: processing 'Expose'");
                         if (ev.xexpose.count == 0 && win->visible) {
+                                draw_invalidate();
                                 draw();
                         }
                         break;
@@ -333,28 +636,42 @@ gboolean x_mainloop_fd_dispatch(GSource *source, GSourceFunc callback, gpointer
                             ev.xcreatewindow.override_redirect == 0)
                                 XRaiseWindow(xctx.dpy, win->xwin);
                         break;
+                case PropertyNotify:
+                        if (ev.xproperty.window != root) {
+                                /* The active window, we only care about its fullscreen state */
+                                if (   is_active_window(ev.xproperty.window)
+                                    && ev.xproperty.atom == xctx.atoms[NET_WM_STATE]) {
+                                        LOG_D("XEvent: processing 'PropertyNotify' of the active window");
+                                        x_fullscreen_update();
+                                }
+                                break;
+                        }
+                        if (ev.xproperty.atom == xctx.atoms[NET_ACTIVE_WINDOW]) {
+                                LOG_D("XEvent: processing 'PropertyNotify' for _NET_ACTIVE_WINDOW");
+                                active_window_update();
+                                x_fullscreen_update();
+                        }
+                        /* fall through */
                 case FocusIn:
                 case FocusOut:
-                case PropertyNotify:
-                        LOG_D("XEvent: Checking for active screen changes");
-                        fullscreen_now = have_fullscreen_window();
-                        scr = get_active_screen();
-
-                        if (fullscreen_now != fullscreen_last) {
-                                fullscreen_last = fullscreen_now;
-                                wake_up();
-                        } else if (   settings.f_mode != FOLLOW_NONE
                         /* Ignore PropertyNotify, when we're still on the
                          * same screen. PropertyNotify is only necessary
                          * to detect a focus change to another screen
                          */
-                                   && win->visible
-                                   && scr->id != win->cur_screen) {
-                                draw();
-                                win->cur_screen = scr->id;
+                        if (settings.f_mode != FOLLOW_NONE && win->visible) {
+                                LOG_D("XEvent: Checking for active screen changes");
+                                scr = get_active_screen();
+                                if (scr->id != win->cur_screen) {
+                                        draw();
+                                        win->cur_screen = scr->id;
+                                }
                         }
                         break;
                 default:
+                        if (x_idle_check_event(&ev))
+                                break;
+                        if (x_shm_check_event(&ev))
+                                break;
                         screen_check_event(ev);
                         break;
                 }
@@ -362,6 +679,104 @@ gboolean x_mainloop_fd_dispatch(GSource *source, GSourceFunc callback, gpointer
         return G_SOURCE_CONTINUE;
 }
 
+/*
+ * Create an alarm, which fires when the IDLETIME counter passes the
+ * given value in the direction of test.
+ */
+static XSyncAlarm x_idle_alarm_create(gint64 value, XSyncTestType test)
+{
+        XSyncAlarmAttributes attr;
+
+        attr.trigger.counter = idle.counter;
+        attr.trigger.value_type = XSyncAbsolute;
+        attr.trigger.test_type = test;
+        XSyncIntsToValue(&attr.trigger.wait_value, value & 0xffffffff, value >> 32);
+        /* transition alarms with a zero delta stay active after firing */
+        XSyncIntToValue(&attr.delta, 0);
+        attr.events = true;
+
+        return XSyncCreateAlarm(xctx.dpy,
+                                XSyncCACounter | XSyncCAValueType | XSyncCATestType
+                                | XSyncCAValue | XSyncCADelta | XSyncCAEvents,
+                                &attr);
+}
+
+/*
+ * Set up alarms for the idle_threshold, so dunst doesn't have to poll
+ * the idle time. Without the XSync extension or its IDLETIME counter,
+ * idle.counter stays None.
+ */
+static void x_idle_setup(void)
+{
+        int error_base, major, minor, n;
+
+        if (settings.idle_threshold == 0)
+                return;
+
+        if (   !XSyncQueryExtension(xctx.dpy, &idle.event_base, &error_base)
+            || !XSyncInitialize(xctx.dpy, &major, &minor)) {
+                LOG_I("XSync extension not available, polling the idle time.");
+                return;
+        }
+
+        XSyncSystemCounter *counters = XSyncListSystemCounters(xctx.dpy, &n);
+        for (int i = 0; i < n; i++) {
+                if (STR_EQ(counters[i].name, "IDLETIME"))
+                        idle.counter = counters[i].counter;
+        }
+        if (counters)
+                XSyncFreeSystemCounterList(counters);
+
+        if (idle.counter == None) {
+                LOG_I("No IDLETIME counter available, polling the idle time.");
+                return;
+        }
+
+        gint64 threshold = settings.idle_threshold / 1000;
+        idle.idle = x_idle_alarm_create(threshold, XSyncPositiveTransition);
+        idle.active = x_idle_alarm_create(threshold, XSyncNegativeTransition);
+
+        /* The alarms only report changes */
+        XScreenSaverQueryInfo(xctx.dpy, DefaultRootWindow(xctx.dpy),
+                              xctx.screensaver_info);
+        idle.is_idle = xctx.screensaver_info->idle > threshold;
+}
+
+static void x_idle_teardown(void)
+{
+        if (idle.counter == None)
+                return;
+
+        XSyncDestroyAlarm(xctx.dpy, idle.idle);
+        XSyncDestroyAlarm(xctx.dpy, idle.active);
+        idle.counter = None;
+}
+
+/*
+ * Handle the alarm events of the idle tracker.
+ *
+ * Returns true, if the event belonged to the idle tracker.
+ */
+static bool x_idle_check_event(XEvent *ev)
+{
+        if (idle.counter == None || ev->type != idle.event_base + XSyncAlarmNotify)
+                return false;
+
+        XSyncAlarmNotifyEvent *ev_alarm = (XSyncAlarmNotifyEvent *) ev;
+        if (   ev_alarm->state == XSyncAlarmDestroyed
+            || (ev_alarm->alarm != idle.idle && ev_alarm->alarm != idle.active))
+                return true;
+
+        bool is_idle = ev_alarm->alarm == idle.idle;
+        LOG_D("XEvent: processing 'XSyncAlarmNotify', user is %s", is_idle ? "idle" : "active");
+
+        if (is_idle != idle.is_idle) {
+                idle.is_idle = is_idle;
+                wake_up();
+        }
+        return true;
+}
+
 /*
  * Returns current idle time in milliseconds
  */
@@ -381,9 +796,18 @@ bool x_is_idle(void)
         if (settings.idle_threshold == 0) {
                 return false;
         }
+        if (idle.counter != None)
+                return idle.is_idle;
+
         return x_get_idle_time() > settings.idle_threshold / 1000;
 }
 
+/* see x.h */
+bool x_idle_is_tracked(void)
+{
+        return idle.counter != None;
+}
+
 /* TODO move to x_mainloop_* */
 /*
  * Handle incoming mouse click events
@@ -439,6 +863,9 @@ static void x_handle_click(XEvent ev)
 
 void x_free(void)
 {
+        if (xctx.dpy)
+                x_idle_teardown();
+
         if (xctx.screensaver_info)
                 XFree(xctx.screensaver_info);
 
@@ -474,6 +901,15 @@ void x_setup(void)
         x_shortcut_ungrab(&settings.context_ks);
 
         xctx.screensaver_info = XScreenSaverAllocInfo();
+        x_idle_setup();
+
+        /* One round trip for all atoms instead of one per lookup */
+        XInternAtoms(xctx.dpy, (char **) atom_names, X_ATOM_COUNT, false, xctx.atoms);
+
+        xctx.shm = XShmQueryExtension(xctx.dpy);
+        if (xctx.shm)
+                xctx.shm_completion = XShmGetEventBase(xctx.dpy) + ShmCompletion;
+        LOG_D("MIT-SHM extension %savailable", xctx.shm ? "" : "not ");
 
         init_screens();
         x_shortcut_grab(&settings.history_ks);
@@ -509,14 +945,11 @@ static void x_set_wm(Window win)
 
         /* set window title */
         char *title = settings.title != NULL ? settings.title : "Dunst";
-        Atom _net_wm_title =
-                XInternAtom(xctx.dpy, "_NET_WM_NAME", false);
-
         XStoreName(xctx.dpy, win, title);
         XChangeProperty(xctx.dpy,
                         win,
-                        _net_wm_title,
-                        XInternAtom(xctx.dpy, "UTF8_STRING", false),
+                        xctx.atoms[NET_WM_NAME],
+                        xctx.atoms[UTF8_STRING],
                         8,
                         PropModeReplace,
                         (unsigned char *)title,
@@ -529,15 +962,12 @@ static void x_set_wm(Window win)
         XSetClassHint(xctx.dpy, win, &classhint);
 
         /* set window type */
-        Atom net_wm_window_type =
-                XInternAtom(xctx.dpy, "_NET_WM_WINDOW_TYPE", false);
-
-        data[0] = XInternAtom(xctx.dpy, "_NET_WM_WINDOW_TYPE_NOTIFICATION", false);
-        data[1] = XInternAtom(xctx.dpy, "_NET_WM_WINDOW_TYPE_UTILITY", false);
+        data[0] = xctx.atoms[NET_WM_WINDOW_TYPE_NOTIFICATION];
+        data[1] = xctx.atoms[NET_WM_WINDOW_TYPE_UTILITY];
 
         XChangeProperty(xctx.dpy,
                         win,
-                        net_wm_window_type,
+                        xctx.atoms[NET_WM_WINDOW_TYPE],
                         XA_ATOM,
                         32,
                         PropModeReplace,
@@ -545,12 +975,9 @@ static void x_set_wm(Window win)
                         2L);
 
         /* set state above */
-        Atom net_wm_state =
-                XInternAtom(xctx.dpy, "_NET_WM_STATE", false);
-
-        data[0] = XInternAtom(xctx.dpy, "_NET_WM_STATE_ABOVE", false);
+        data[0] = xctx.atoms[NET_WM_STATE_ABOVE];
 
-        XChangeProperty(xctx.dpy, win, net_wm_state, XA_ATOM, 32,
+        XChangeProperty(xctx.dpy, win, xctx.atoms[NET_WM_STATE], XA_ATOM, 32,
                 PropModeReplace, (unsigned char *) data, 1L);
 }
 
@@ -622,15 +1049,20 @@ struct window_x11 *x_win_create(void)
                                                       DefaultVisual(xctx.dpy, 0),
                                                       WIDTH, HEIGHT);
         win->c_ctx = cairo_create(win->root_surface);
+        win->gc = XCreateGC(xctx.dpy, win->xwin, 0, NULL);
 
         win->esrc = x_win_reg_source(win);
 
-        long root_event_mask = SubstructureNotifyMask;
+        /* PropertyNotify on the root reports changes of _NET_ACTIVE_WINDOW */
+        long root_event_mask = SubstructureNotifyMask | PropertyChangeMask;
         if (settings.f_mode != FOLLOW_NONE) {
-                root_event_mask |= FocusChangeMask | PropertyChangeMask;
+                root_event_mask |= FocusChangeMask;
         }
         XSelectInput(xctx.dpy, root, root_event_mask);
 
+        active_window_update();
+        dunst_status(S_FULLSCREEN, have_fullscreen_window());
+
         return win;
 }
 
@@ -639,8 +1071,12 @@ void x_win_destroy(struct window_x11 *win)
         g_source_destroy(win->esrc);
         g_source_unref(win->esrc);
 
+        for (int i = 0; i < G_N_ELEMENTS(win->shm); i++)
+                g_clear_pointer(&win->shm[i], shm_buffer_free);
+
         cairo_destroy(win->c_ctx);
         cairo_surface_destroy(win->root_surface);
+        XFreeGC(xctx.dpy, win->gc);
         XDestroyWindow(xctx.dpy, win->xwin);
 
         g_free(win);
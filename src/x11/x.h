@@ -35,9 +35,31 @@ struct dimensions {
         int corner_radius;
 };
 
+/**
+ * The atoms dunst uses. They get interned once in x_setup() and are
+ * available in xctx.atoms.
+ */
+enum x_atom {
+        NET_ACTIVE_WINDOW,
+        NET_WM_NAME,
+        NET_WM_STATE,
+        NET_WM_STATE_ABOVE,
+        NET_WM_STATE_FULLSCREEN,
+        NET_WM_WINDOW_OPACITY,
+        NET_WM_WINDOW_TYPE,
+        NET_WM_WINDOW_TYPE_NOTIFICATION,
+        NET_WM_WINDOW_TYPE_UTILITY,
+        UTF8_STRING,
+        X_ATOM_COUNT
+};
+
 struct x_context {
         Display *dpy;
         XScreenSaverInfo *screensaver_info;
+        bool shm; /**< The MIT-SHM extension is usable */
+        int shm_completion; /**< The event type of ShmCompletion events */
+        unsigned long round_trips; /**< Synchronous requests sent while drawing, for debugging */
+        Atom atoms[X_ATOM_COUNT];
 };
 
 struct color {
@@ -55,14 +77,39 @@ void x_win_destroy(struct window_x11 *win);
 void x_win_show(struct window_x11 *win);
 void x_win_hide(struct window_x11 *win);
 
-void x_display_surface(cairo_surface_t *srf, struct window_x11 *win, const struct dimensions *dim);
+/**
+ * Move the window to the given dimensions and copy the surface into it.
+ *
+ * If the X server supports MIT-SHM, the pixels get handed over through
+ * shared memory instead of the socket (e.g. not on remote displays).
+ *
+ * @param srf The content of the whole window
+ * @param win The window to display the surface in
+ * @param dim The position and size of the window
+ * @param damage (nullable) The areas of srf, which changed since the
+ *               last call, or NULL to copy the whole surface
+ */
+void x_display_surface(cairo_surface_t *srf, struct window_x11 *win, const struct dimensions *dim, const cairo_region_t *damage);
 
 bool x_win_visible(struct window_x11 *win);
 cairo_t* x_win_get_context(struct window_x11 *win);
 
 /* X misc */
 unsigned long x_get_idle_time(void);
+
+/**
+ * Check whether the user is currently idle.
+ *
+ * With alarms on the XSync IDLETIME counter, this is answered from the
+ * last alarm event without asking the server.
+ */
 bool x_is_idle(void);
+
+/**
+ * @return true, if becoming idle or active gets reported by X events,
+ *         which wake up dunst. Otherwise the idle time has to be polled.
+ */
+bool x_idle_is_tracked(void);
 void x_setup(void);
 void x_free(void);
 
@@ -15,9 +15,75 @@ TEST test_dunst_status(void)
         PASS();
 }
 
+static gboolean timer_fired(void *data)
+{
+        (*(int *) data)++;
+        return G_SOURCE_CONTINUE;
+}
+
+TEST test_timer_source_rearm(void)
+{
+        int fired = 0;
+        GMainContext *ctx = g_main_context_new();
+        struct timer_source *ts = timer_source_new("test", ctx, timer_fired);
+        g_source_set_callback(&ts->source, timer_fired, &fired, NULL);
+
+        timer_source_arm(ts, time_monotonic_now() + S2US(60));
+        gint64 deadline = time_monotonic_now() + 2500;
+        timer_source_arm(ts, deadline);
+
+        while (fired == 0)
+                g_main_context_iteration(ctx, TRUE);
+
+        ASSERT(time_monotonic_now() >= deadline);
+        ASSERT_EQ(1, ts->wakeups);
+        ASSERT_EQ(0, ts->spurious);
+        ASSERT_EQ(-1, ts->deadline);
+
+        /* a disarmed timer must not dispatch */
+        ASSERT_FALSE(g_main_context_iteration(ctx, FALSE));
+        ASSERT_EQ(1, fired);
+
+        timer_source_destroy(ts);
+        g_main_context_unref(ctx);
+        PASS();
+}
+
+TEST test_wake_up_coalesces(void)
+{
+        int fired = 0;
+        int max_fps = settings.max_fps;
+        frame = timer_source_new("frame", NULL, timer_fired);
+        g_source_set_callback(&frame->source, timer_fired, &fired, NULL);
+
+        settings.max_fps = 0;
+        frames_coalesced = 0;
+        wake_up();
+        wake_up();
+        wake_up();
+        ASSERT_EQ(2, frames_coalesced);
+
+        while (fired == 0)
+                g_main_context_iteration(NULL, TRUE);
+        ASSERT_EQ(1, fired);
+        ASSERT_FALSE(g_main_context_iteration(NULL, FALSE));
+
+        /* the next frame has to wait for the frame interval */
+        settings.max_fps = 10;
+        frame_last = time_monotonic_now();
+        wake_up();
+        ASSERT(frame->deadline >= frame_last + S2US(1) / 10);
+
+        settings.max_fps = max_fps;
+        g_clear_pointer(&frame, timer_source_destroy);
+        PASS();
+}
+
 SUITE(suite_dunst)
 {
         RUN_TEST(test_dunst_status);
+        RUN_TEST(test_timer_source_rearm);
+        RUN_TEST(test_wake_up_coalesces);
 }
 
 /* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
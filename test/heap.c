@@ -0,0 +1,117 @@
+#include "../src/heap.c"
+#include "greatest.h"
+
+static int cmp_int(gconstpointer a, gconstpointer b)
+{
+        return GPOINTER_TO_INT(a) - GPOINTER_TO_INT(b);
+}
+
+/**
+ * Check the heap property for all nodes of the heap
+ */
+TEST assert_heap_valid(struct heap *h)
+{
+        for (unsigned int i = 0; i < heap_length(h); i++) {
+                struct heap_node *node = heap_nth(h, i);
+                ASSERT_EQ(i, node->pos);
+                if (i > 0)
+                        ASSERT(heap_node_cmp(h, heap_nth(h, (i - 1) / 2), node) < 0);
+        }
+        PASS();
+}
+
+TEST test_heap_order(void)
+{
+        struct heap *h = heap_new(cmp_int);
+        int values[] = { 5, 3, 8, 1, 9, 2, 7, 4, 6, 0 };
+
+        ASSERT(heap_peek(h) == NULL);
+
+        for (int i = 0; i < G_N_ELEMENTS(values); i++)
+                heap_push(h, GINT_TO_POINTER(values[i]));
+        CHECK_CALL(assert_heap_valid(h));
+        ASSERT_EQ(G_N_ELEMENTS(values), heap_length(h));
+
+        for (int i = 0; i < G_N_ELEMENTS(values); i++)
+                ASSERT_EQ(i, GPOINTER_TO_INT(heap_remove(h, heap_peek(h))));
+
+        ASSERT_EQ(0, heap_length(h));
+
+        heap_free(h, NULL);
+        PASS();
+}
+
+TEST test_heap_ties_lifo(void)
+{
+        struct heap *h = heap_new(cmp_int);
+        struct heap_node *n1 = heap_push(h, GINT_TO_POINTER(1));
+        struct heap_node *n2 = heap_push(h, GINT_TO_POINTER(1));
+        struct heap_node *n3 = heap_push(h, GINT_TO_POINTER(1));
+
+        ASSERT_EQ(n3, heap_peek(h));
+        heap_remove(h, n3);
+        ASSERT_EQ(n2, heap_peek(h));
+        heap_remove(h, n2);
+        ASSERT_EQ(n1, heap_peek(h));
+
+        heap_free(h, NULL);
+        PASS();
+}
+
+TEST test_heap_remove_update(void)
+{
+        struct heap *h = heap_new(cmp_int);
+        struct heap_node *nodes[100];
+
+        for (int i = 0; i < 100; i++)
+                nodes[i] = heap_push(h, GINT_TO_POINTER((i * 37) % 100));
+
+        // remove every third node
+        for (int i = 0; i < 100; i += 3)
+                heap_remove(h, nodes[i]);
+        CHECK_CALL(assert_heap_valid(h));
+        ASSERT_EQ(66, heap_length(h));
+
+        // move a node to the top and another one to the bottom
+        nodes[1]->data = GINT_TO_POINTER(-1);
+        heap_update(h, nodes[1]);
+        nodes[2]->data = GINT_TO_POINTER(1000);
+        heap_update(h, nodes[2]);
+        CHECK_CALL(assert_heap_valid(h));
+        ASSERT_EQ(nodes[1], heap_peek(h));
+
+        int last = -2;
+        while (heap_length(h) > 0) {
+                int cur = GPOINTER_TO_INT(heap_remove(h, heap_peek(h)));
+                ASSERT(last <= cur);
+                last = cur;
+        }
+        ASSERT_EQ(1000, last);
+
+        heap_free(h, NULL);
+        PASS();
+}
+
+TEST test_heap_free_data(void)
+{
+        struct heap *h = heap_new((GCompareFunc) g_strcmp0);
+
+        heap_push(h, g_strdup("a"));
+        heap_push(h, g_strdup("b"));
+
+        // Now we have to rely on valgrind to test, that
+        // it gets actually freed
+        heap_free(h, g_free);
+        heap_free(NULL, g_free);
+
+        PASS();
+}
+
+SUITE(suite_heap)
+{
+        RUN_TEST(test_heap_order);
+        RUN_TEST(test_heap_ties_lifo);
+        RUN_TEST(test_heap_remove_update);
+        RUN_TEST(test_heap_free_data);
+}
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -1,6 +1,8 @@
 #include "../src/icon.c"
 #include "greatest.h"
 
+#include <utime.h>
+
 #define ICONPREFIX "/data/icons/path"
 
 /* As there are no hints to test if the loaded GdkPixbuf is
@@ -113,6 +115,307 @@ TEST test_get_pixbuf_from_icon_fileuri(void)
         PASS();
 }
 
+TEST test_gdk_pixbuf_to_cairo_surface_rgba(void)
+{
+        const guchar pixels[] = {
+                255, 128,   0, 128,
+                 10,  20,  30, 255,
+                 40,  50,  60,   0,
+        };
+        GdkPixbuf *pixbuf = gdk_pixbuf_new_from_data(pixels, GDK_COLORSPACE_RGB,
+                                                     true, 8, 3, 1, 12, NULL, NULL);
+
+        cairo_surface_t *srf = gdk_pixbuf_to_cairo_surface(pixbuf);
+        ASSERT(srf);
+        ASSERT_EQ(CAIRO_FORMAT_ARGB32, cairo_image_surface_get_format(srf));
+
+        const uint32_t *data = (const uint32_t *) cairo_image_surface_get_data(srf);
+        ASSERT_EQ_FMT(0x80804000, data[0], "0x%08x");
+        ASSERT_EQ_FMT(0xff0a141e, data[1], "0x%08x");
+        ASSERT_EQ_FMT(0x00000000, data[2], "0x%08x");
+
+        cairo_surface_destroy(srf);
+        g_object_unref(pixbuf);
+        PASS();
+}
+
+TEST test_gdk_pixbuf_to_cairo_surface_rgb(void)
+{
+        const guchar pixels[] = {
+                255, 128,   0,   0,
+                 10,  20,  30,   0,
+        };
+        GdkPixbuf *pixbuf = gdk_pixbuf_new_from_data(pixels, GDK_COLORSPACE_RGB,
+                                                     false, 8, 1, 2, 4, NULL, NULL);
+
+        cairo_surface_t *srf = gdk_pixbuf_to_cairo_surface(pixbuf);
+        ASSERT(srf);
+        ASSERT_EQ(CAIRO_FORMAT_RGB24, cairo_image_surface_get_format(srf));
+
+        const unsigned char *data = cairo_image_surface_get_data(srf);
+        int stride = cairo_image_surface_get_stride(srf);
+        ASSERT_EQ_FMT(0xffff8000, *(const uint32_t *) data, "0x%08x");
+        ASSERT_EQ_FMT(0xff0a141e, *(const uint32_t *) (data + stride), "0x%08x");
+
+        cairo_surface_destroy(srf);
+        g_object_unref(pixbuf);
+        PASS();
+}
+
+static cairo_status_t read_from_buf(void *closure, unsigned char *data, unsigned int size)
+{
+        GByteArray *buf = (GByteArray *)closure;
+
+        unsigned int cpy = MIN(size, buf->len);
+        memcpy(data, buf->data, cpy);
+        g_byte_array_remove_range(buf, 0, cpy);
+
+        return CAIRO_STATUS_SUCCESS;
+}
+
+/**
+ * The former conversion via a PNG round trip, as in bench/icon.c
+ */
+static cairo_surface_t *pixbuf_to_surface_png(GdkPixbuf *pixbuf)
+{
+        cairo_surface_t *icon_surface = NULL;
+        GByteArray *buffer;
+        char *bufstr;
+        gsize buflen;
+
+        gdk_pixbuf_save_to_buffer(pixbuf, &bufstr, &buflen, "png", NULL, NULL);
+
+        buffer = g_byte_array_new_take((guint8*)bufstr, buflen);
+        icon_surface = cairo_image_surface_create_from_png_stream(read_from_buf, buffer);
+
+        g_byte_array_free(buffer, TRUE);
+
+        return icon_surface;
+}
+
+TEST test_gdk_pixbuf_to_cairo_surface_png(void)
+{
+        GRand *rand = g_rand_new_with_seed(42);
+
+        // odd widths leave a rest after the vectorized pixels
+        for (int width = 1; width <= 21; width++) {
+                for (int alpha = 0; alpha < 2; alpha++) {
+                        GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, alpha, 8, width, 3);
+                        guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+                        int src_stride = gdk_pixbuf_get_rowstride(pixbuf);
+                        int n_channels = gdk_pixbuf_get_n_channels(pixbuf);
+
+                        for (int y = 0; y < 3; y++)
+                                for (int x = 0; x < width * n_channels; x++)
+                                        pixels[y * src_stride + x] = g_rand_int_range(rand, 0, 256);
+                        // fully opaque and fully transparent pixels, too
+                        if (alpha) {
+                                pixels[3] = 255;
+                                pixels[src_stride + 3] = 0;
+                        }
+
+                        cairo_surface_t *direct = gdk_pixbuf_to_cairo_surface(pixbuf);
+                        cairo_surface_t *png = pixbuf_to_surface_png(pixbuf);
+                        ASSERT_EQ(cairo_image_surface_get_format(png),
+                                  cairo_image_surface_get_format(direct));
+
+                        int stride = cairo_image_surface_get_stride(direct);
+                        ASSERT_EQ(cairo_image_surface_get_stride(png), stride);
+                        for (int y = 0; y < 3; y++) {
+                                const unsigned char *a = cairo_image_surface_get_data(direct) + y * stride;
+                                const unsigned char *b = cairo_image_surface_get_data(png) + y * stride;
+                                ASSERT_MEM_EQ(b, a, width * 4);
+                        }
+
+                        cairo_surface_destroy(direct);
+                        cairo_surface_destroy(png);
+                        g_object_unref(pixbuf);
+                }
+        }
+
+        g_rand_free(rand);
+        PASS();
+}
+
+TEST test_icon_index_precedence(void)
+{
+        GQueue *candidates = icon_index_lookup("icon1");
+        ASSERT(candidates);
+        ASSERT_EQ(4, g_queue_get_length(candidates));
+
+        struct icon_candidate *first = g_queue_peek_head(candidates);
+        struct icon_candidate *last = g_queue_peek_tail(candidates);
+        ASSERT(g_str_has_suffix(first->path, "/invalid/icon1.svg"));
+        ASSERT(g_str_has_suffix(last->path, "/valid/icon1.png"));
+
+        ASSERT(icon_index_lookup("invalid") == NULL);
+        PASS();
+}
+
+TEST test_icon_index_changed(void)
+{
+        char *icon_path = settings.icon_path;
+        char *dir = g_dir_make_tmp("dunst-test-XXXXXX", NULL);
+        char *path = g_build_filename(dir, "new.png", NULL);
+        GFile *file = g_file_new_for_path(path);
+        ASSERT(dir);
+
+        settings.icon_path = dir;
+        ASSERT(icon_index_lookup("new") == NULL);
+
+        ASSERT(g_file_set_contents(path, "", 0, NULL));
+        icon_index_changed(NULL, file, NULL, G_FILE_MONITOR_EVENT_CREATED, GINT_TO_POINTER(0));
+        GQueue *candidates = icon_index_lookup("new");
+        ASSERT(candidates);
+        ASSERT_STR_EQ(path, ((struct icon_candidate *) g_queue_peek_head(candidates))->path);
+
+        remove(path);
+        icon_index_changed(NULL, file, NULL, G_FILE_MONITOR_EVENT_DELETED, GINT_TO_POINTER(0));
+        ASSERT(icon_index_lookup("new") == NULL);
+
+        settings.icon_path = icon_path;
+        icon_index_teardown();
+        remove(dir);
+        g_object_unref(file);
+        g_free(path);
+        g_free(dir);
+        PASS();
+}
+
+static struct raw_image *test_raw_image(unsigned char pixel)
+{
+        struct raw_image *raw = g_malloc(sizeof(struct raw_image));
+
+        raw->width = 2;
+        raw->height = 2;
+        raw->rowstride = 6;
+        raw->has_alpha = false;
+        raw->bits_per_sample = 8;
+        raw->n_channels = 3;
+        raw->data = g_malloc(12);
+        memset(raw->data, pixel, 12);
+        raw->checksum = NULL;
+
+        return raw;
+}
+
+TEST test_icon_cache_hit(void)
+{
+        unsigned int hits = icon_cache_hits, misses = icon_cache_misses;
+        struct notification *n = notification_create();
+        n->icon = g_strconcat(base, "/data/icons/valid.png", NULL);
+
+        cairo_surface_t *a = icon_get_for_notification(n);
+        cairo_surface_t *b = icon_get_for_notification(n);
+        ASSERT(a);
+        ASSERT(a == b);
+        ASSERT_EQ(misses + 1, icon_cache_misses);
+        ASSERT_EQ(hits + 1, icon_cache_hits);
+
+        cairo_surface_destroy(a);
+        cairo_surface_destroy(b);
+        notification_unref(n);
+        icon_cache_teardown();
+        PASS();
+}
+
+TEST test_icon_cache_raw(void)
+{
+        struct notification *a = notification_create();
+        struct notification *b = notification_create();
+        struct notification *c = notification_create();
+        a->raw_icon = test_raw_image(0x10);
+        b->raw_icon = test_raw_image(0x10);
+        c->raw_icon = test_raw_image(0x20);
+
+        cairo_surface_t *sa = icon_get_for_notification(a);
+        cairo_surface_t *sb = icon_get_for_notification(b);
+        cairo_surface_t *sc = icon_get_for_notification(c);
+        ASSERT(sa);
+        ASSERTm("Equal pixel data should share the surface", sa == sb);
+        ASSERTm("Different pixel data must not share the surface", sa != sc);
+
+        // the pixels get hashed only once
+        char *checksum = a->raw_icon->checksum;
+        ASSERT(checksum);
+        cairo_surface_destroy(icon_get_for_notification(a));
+        ASSERT_EQ(checksum, a->raw_icon->checksum);
+
+        cairo_surface_destroy(sa);
+        cairo_surface_destroy(sb);
+        cairo_surface_destroy(sc);
+        notification_unref(a);
+        notification_unref(b);
+        notification_unref(c);
+        icon_cache_teardown();
+        PASS();
+}
+
+TEST test_icon_cache_eviction(void)
+{
+        int cache_size = settings.icon_cache_size;
+        unsigned int evictions = icon_cache_evictions;
+        struct notification *svg = notification_create();
+        struct notification *png = notification_create();
+        svg->icon = g_strconcat(base, "/data/icons/valid.svg", NULL);
+        png->icon = g_strconcat(base, "/data/icons/valid.png", NULL);
+
+        /* the 16x16 SVG fills the cache completely */
+        settings.icon_cache_size = 1;
+        cairo_surface_t *a = icon_get_for_notification(svg);
+        cairo_surface_t *b = icon_get_for_notification(png);
+        ASSERT_EQ(evictions + 1, icon_cache_evictions);
+        ASSERT_EQ(1, g_hash_table_size(icon_cache));
+        ASSERT_EQ(64, icon_cache_used);
+
+        cairo_surface_destroy(a);
+        cairo_surface_destroy(b);
+        notification_unref(svg);
+        notification_unref(png);
+        icon_cache_teardown();
+        settings.icon_cache_size = cache_size;
+        PASS();
+}
+
+TEST test_icon_cache_mtime(void)
+{
+        char *dir = g_dir_make_tmp("dunst-test-XXXXXX", NULL);
+        char *src = g_strconcat(base, "/data/icons/valid.png", NULL);
+        char *contents;
+        gsize len;
+        struct stat st;
+        struct notification *n = notification_create();
+        n->icon = g_build_filename(dir, "icon.png", NULL);
+
+        ASSERT(dir);
+        ASSERT(g_file_get_contents(src, &contents, &len, NULL));
+        ASSERT(g_file_set_contents(n->icon, contents, len, NULL));
+
+        cairo_surface_t *a = icon_get_for_notification(n);
+        ASSERT(a);
+
+        ASSERT_EQ(0, stat(n->icon, &st));
+        struct utimbuf times = { st.st_atime, st.st_mtime + 10 };
+        ASSERT_EQ(0, utime(n->icon, &times));
+
+        unsigned int misses = icon_cache_misses;
+        cairo_surface_t *b = icon_get_for_notification(n);
+        ASSERT(b);
+        ASSERT(a != b);
+        ASSERT_EQ(misses + 1, icon_cache_misses);
+
+        cairo_surface_destroy(a);
+        cairo_surface_destroy(b);
+        remove(n->icon);
+        remove(dir);
+        notification_unref(n);
+        icon_cache_teardown();
+        g_free(contents);
+        g_free(src);
+        g_free(dir);
+        PASS();
+}
+
 SUITE(suite_icon)
 {
         settings.icon_path = g_strconcat(
@@ -120,6 +423,7 @@ SUITE(suite_icon)
                 ":", base, ICONPREFIX "/valid"
                 ":", base, ICONPREFIX "/both",
                 NULL);
+        settings.icon_cache_size = 4096;
 
         RUN_TEST(test_get_pixbuf_from_file_tilde);
         RUN_TEST(test_get_pixbuf_from_file_absolute);
@@ -129,7 +433,17 @@ SUITE(suite_icon)
         RUN_TEST(test_get_pixbuf_from_icon_onlypng);
         RUN_TEST(test_get_pixbuf_from_icon_filename);
         RUN_TEST(test_get_pixbuf_from_icon_fileuri);
+        RUN_TEST(test_icon_index_precedence);
+        RUN_TEST(test_icon_index_changed);
+        RUN_TEST(test_gdk_pixbuf_to_cairo_surface_rgba);
+        RUN_TEST(test_gdk_pixbuf_to_cairo_surface_rgb);
+        RUN_TEST(test_gdk_pixbuf_to_cairo_surface_png);
+        RUN_TEST(test_icon_cache_hit);
+        RUN_TEST(test_icon_cache_raw);
+        RUN_TEST(test_icon_cache_eviction);
+        RUN_TEST(test_icon_cache_mtime);
 
+        icon_index_teardown();
         g_clear_pointer(&settings.icon_path, g_free);
 }
 /* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
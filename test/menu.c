@@ -0,0 +1,44 @@
+#include "../src/menu.c"
+#include "greatest.h"
+
+TEST helper_extract_urls(const char *in, const char *exp)
+{
+        char *urls = extract_urls(in);
+
+        ASSERT_STR_EQ(exp, urls);
+        g_free(urls);
+
+        PASS();
+}
+
+TEST test_extract_urls(void)
+{
+        char *urls;
+
+        ASSERT_EQ(NULL, (urls = extract_urls("")));
+        ASSERT_EQ(NULL, (urls = extract_urls("no urls here")));
+        ASSERT_EQ(NULL, (urls = extract_urls("http://")));
+        ASSERT_EQ(NULL, (urls = extract_urls("foowww.example.org _http://example.org")));
+
+        RUN_TESTp(helper_extract_urls, "Visit https://dunst-project.org.", "https://dunst-project.org");
+        RUN_TESTp(helper_extract_urls, "a www.x.org b HTTP://Y.org",       "www.x.org\nHTTP://Y.org");
+        RUN_TESTp(helper_extract_urls, "mail mailto:a@b.c!",               "mailto:a@b.c");
+        RUN_TESTp(helper_extract_urls, "file:///tmp/a.txt,ftp://host/b",   "file:///tmp/a.txt,ftp://host/b");
+
+        // Parentheses are only allowed in pairs and end the trailing punctuation
+        RUN_TESTp(helper_extract_urls, "see (http://en.wikipedia.org/wiki/Foo_(bar)), ok", "http://en.wikipedia.org/wiki/Foo_(bar)");
+        RUN_TESTp(helper_extract_urls, "http://x(y).z",                    "http://x(y)");
+        RUN_TESTp(helper_extract_urls, "http://(www.example.org",          "www.example.org");
+
+        // Non-ASCII letters belong to the URL, other symbols end it
+        RUN_TESTp(helper_extract_urls, "https://de.wikipedia.org/wiki/Straße…", "https://de.wikipedia.org/wiki/Straße");
+
+        PASS();
+}
+
+SUITE(suite_menu)
+{
+        RUN_TEST(test_extract_urls);
+}
+
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -69,6 +69,43 @@ TEST test_notification_is_duplicate(struct notification *a,
         PASS();
 }
 
+TEST test_notification_fingerprint(void)
+{
+        struct notification *a = notification_create();
+        struct notification *b = notification_create();
+        a->summary = g_strdup("Summary");
+        b->summary = g_strdup("Summary");
+        a->icon = g_strdup("Icon");
+        b->icon = g_strdup("Icon");
+
+        notification_init(a);
+        notification_init(b);
+        ASSERT(notification_is_duplicate(a, b));
+        ASSERT_EQ(a->fingerprint, b->fingerprint);
+        ASSERT_EQ(a->fingerprint, notification_fingerprint(b));
+
+        char *tmp = b->summary;
+        b->summary = "Something different";
+        ASSERT(a->fingerprint != notification_fingerprint(b));
+        b->summary = tmp;
+
+        enum icon_position icon_setting_tmp = settings.icon_position;
+        tmp = b->icon;
+        b->icon = "Test1";
+
+        settings.icon_position = ICON_OFF;
+        ASSERT_EQ(notification_fingerprint(a), notification_fingerprint(b));
+        settings.icon_position = ICON_LEFT;
+        ASSERT(notification_fingerprint(a) != notification_fingerprint(b));
+
+        b->icon = tmp;
+        settings.icon_position = icon_setting_tmp;
+
+        notification_unref(a);
+        notification_unref(b);
+        PASS();
+}
+
 TEST test_notification_replace_single_field(void)
 {
         char *str = g_malloc(128 * sizeof(char));
@@ -114,6 +151,81 @@ TEST test_notification_referencing(void)
         PASS();
 }
 
+static void render_data_free(gpointer data)
+{
+        (*(int *) data)++;
+}
+
+TEST test_notification_render_data(void)
+{
+        int freed_a = 0, freed_b = 0;
+        struct notification *n = notification_create();
+        ASSERT(notification_get_render_data(n) == NULL);
+
+        notification_set_render_data(n, &freed_a, render_data_free);
+        ASSERT(notification_get_render_data(n) == &freed_a);
+
+        notification_set_render_data(n, &freed_b, render_data_free);
+        ASSERT(notification_get_render_data(n) == &freed_b);
+        ASSERT_EQ(1, freed_a);
+        ASSERT_EQ(0, freed_b);
+
+        notification_unref(n);
+        ASSERT_EQ(1, freed_a);
+        ASSERT_EQ(1, freed_b);
+
+        PASS();
+}
+
+TEST test_notification_urls(void)
+{
+        struct notification *n = notification_create();
+        n->summary = g_strdup("Summary");
+        n->body = g_strdup("See www.example.org and https://dunst-project.org.");
+        notification_init(n);
+
+        // the existence check doesn't extract the URLs
+        ASSERT(notification_has_urls(n));
+        ASSERT_EQ(NULL, n->urls);
+        ASSERT_STR_EQ("www.example.org\nhttps://dunst-project.org", notification_get_urls(n));
+        ASSERT(notification_has_urls(n));
+
+        g_free(n->body);
+        n->body = g_strdup("<a href=\"https://dunst-project.org\">Dunst</a>");
+        notification_init(n);
+        ASSERT_EQ(NULL, n->urls);
+        ASSERT(notification_has_urls(n));
+        ASSERT_STR_EQ("[Dunst] https://dunst-project.org", n->urls);
+
+        g_free(n->body);
+        n->body = g_strdup("No URL in here");
+        notification_init(n);
+        ASSERT_FALSE(notification_has_urls(n));
+        ASSERT_EQ(NULL, notification_get_urls(n));
+
+        notification_unref(n);
+        PASS();
+}
+
+TEST test_notification_format_teardown(void)
+{
+        char *format = g_strdup("%a: %s");
+        const struct format_template *t = notification_format_compile(format);
+        ASSERT_EQ(t, notification_format_compile(format));
+
+        notification_format_teardown();
+        ASSERT_EQ(NULL, format_templates);
+        ASSERT_EQ(NULL, last_template);
+
+        /* compiling again has to work after the teardown */
+        ASSERT(notification_format_compile(format));
+        ASSERT_EQ(1, g_hash_table_size(format_templates));
+
+        notification_format_teardown();
+        g_free(format);
+        PASS();
+}
+
 TEST test_notification_format_message(struct notification *n, const char *format, const char *exp)
 {
         n->format = format;
@@ -175,6 +287,9 @@ SUITE(suite_notification)
 
         RUN_TEST(test_notification_replace_single_field);
         RUN_TEST(test_notification_referencing);
+        RUN_TEST(test_notification_render_data);
+        RUN_TEST(test_notification_fingerprint);
+        RUN_TEST(test_notification_urls);
 
         // TEST notification_format_message
         a = notification_create();
@@ -195,6 +310,10 @@ SUITE(suite_notification)
                 "%%", "%",
                 "%",  "%",
                 "%UNKNOWN", "%UNKNOWN",
+                "%a%a", "MyAppMyApp",
+                "%%a", "%a",
+                "%x%a", "%xMyApp",
+                "%a\\n%n%%", "MyApp\n95%",
                 NULL
         };
 
@@ -208,7 +327,9 @@ SUITE(suite_notification)
         g_clear_pointer(&a, notification_unref);
 
         RUN_TEST(test_notification_maxlength);
+        RUN_TEST(test_notification_format_teardown);
 
+        notification_format_teardown();
         g_clear_pointer(&settings.icon_path, g_free);
         g_free(config_path);
 }
@@ -18,7 +18,7 @@ TEST test_queue_length(void)
 
         n = test_notification("n2", 0);
         queues_notification_insert(n);
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
 
         n = test_notification("n3", 0);
         queues_notification_insert(n);
@@ -95,7 +95,7 @@ TEST test_queue_insert_id_replacement(void)
         ASSERT_EQ(a->id, b->id);
         NOT_LAST(a);
 
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         c = test_notification("c", -1);
         c->id = b->id;
 
@@ -120,7 +120,7 @@ TEST test_queue_notification_close(void)
         queues_notification_insert(n);
         QUEUE_LEN_ALL(1, 0, 0);
         queues_notification_close(n, REASON_UNDEF);
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         QUEUE_LEN_ALL(0, 0, 1);
         queues_teardown();
 
@@ -130,10 +130,10 @@ TEST test_queue_notification_close(void)
         queues_init();
         queues_notification_insert(n);
         QUEUE_LEN_ALL(1, 0, 0);
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         QUEUE_LEN_ALL(0, 1, 0);
         queues_notification_close(n, REASON_UNDEF);
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         QUEUE_LEN_ALL(0, 0, 1);
         queues_teardown();
 
@@ -152,7 +152,7 @@ TEST test_queue_notification_close_histignore(void)
         queues_notification_insert(n);
         QUEUE_LEN_ALL(1, 0, 0);
         queues_notification_close(n, REASON_UNDEF);
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         QUEUE_LEN_ALL(0, 0, 0);
         queues_teardown();
 
@@ -163,10 +163,10 @@ TEST test_queue_notification_close_histignore(void)
         queues_init();
         queues_notification_insert(n);
         QUEUE_LEN_ALL(1, 0, 0);
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         QUEUE_LEN_ALL(0, 1, 0);
         queues_notification_close(n, REASON_UNDEF);
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         QUEUE_LEN_ALL(0, 0, 0);
         queues_teardown();
 
@@ -184,7 +184,7 @@ TEST test_queue_history_overfull(void)
                 char name[] = { 'n', '0'+i, '\0' }; // n<i>
                 n = test_notification(name, -1);
                 queues_notification_insert(n);
-                queues_update(STATUS_NORMAL);
+                queues_update(STATUS_NORMAL, time_monotonic_now());
                 queues_notification_close(n, REASON_UNDEF);
         }
 
@@ -216,7 +216,7 @@ TEST test_queue_history_pushall(void)
                 n = test_notification(name, -1);
                 queues_notification_insert(n);
         }
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
 
         for (int i = 0; i < 10; i++) {
                 char name[] = { '2', 'n', '0'+i, '\0' }; // 2n<i>
@@ -235,6 +235,95 @@ TEST test_queue_history_pushall(void)
         PASS();
 }
 
+TEST test_queue_close_id_after_move(void)
+{
+        settings.geometry.h = 0;
+        queues_init();
+
+        struct notification *a = test_notification("a", -1);
+        struct notification *b = test_notification("b", -1);
+        struct notification *c = test_notification("c", -1);
+
+        queues_notification_insert(a);
+        queues_notification_insert(b);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
+        queues_notification_insert(c);
+        QUEUE_LEN_ALL(1, 2, 0);
+
+        queues_notification_close_id(b->id, REASON_UNDEF);
+        QUEUE_CONTAINS(HIST, b);
+        QUEUE_LEN_ALL(1, 1, 1);
+
+        queues_history_pop();
+        QUEUE_CONTAINS(WAIT, b);
+        QUEUE_LEN_ALL(2, 1, 0);
+
+        queues_notification_close_id(b->id, REASON_UNDEF);
+        queues_notification_close_id(c->id, REASON_UNDEF);
+        queues_notification_close_id(a->id, REASON_UNDEF);
+        QUEUE_LEN_ALL(0, 0, 3);
+
+        queues_teardown();
+        PASS();
+}
+
+TEST test_queue_close_id_shared(void)
+{
+        queues_init();
+
+        struct notification *a = test_notification("a", -1);
+        queues_notification_insert(a);
+        queues_notification_close(a, REASON_UNDEF);
+
+        // Reuse the id of a, which now resides in history
+        struct notification *b = test_notification("b", -1);
+        b->id = a->id;
+        queues_notification_insert(b);
+        queues_history_pop();
+        QUEUE_LEN_ALL(2, 0, 0);
+
+        queues_notification_close_id(a->id, REASON_UNDEF);
+        queues_notification_close_id(a->id, REASON_UNDEF);
+        QUEUE_LEN_ALL(0, 0, 2);
+
+        queues_teardown();
+        PASS();
+}
+
+TEST test_queue_waiting_order(void)
+{
+        settings.sort = true;
+        queues_init();
+
+        struct notification *n1 = test_notification("n1", -1);
+        struct notification *n2 = test_notification("n2", -1);
+        struct notification *n3 = test_notification("n3", -1);
+        struct notification *n4 = test_notification("n4", -1);
+        n1->urgency = URG_LOW;
+        n2->urgency = URG_CRIT;
+        n3->urgency = URG_NORM;
+        n4->urgency = URG_CRIT;
+
+        queues_notification_insert(n1);
+        queues_notification_insert(n2);
+        queues_notification_insert(n3);
+        queues_notification_insert(n4);
+        QUEUE_LEN_ALL(4, 0, 0);
+
+        ASSERT_EQ(n2, queues_get_head_waiting());
+        queues_notification_close(n2, REASON_UNDEF);
+        ASSERT_EQ(n4, queues_get_head_waiting());
+        queues_notification_close(n4, REASON_UNDEF);
+        ASSERT_EQ(n3, queues_get_head_waiting());
+        queues_notification_close(n3, REASON_UNDEF);
+        ASSERT_EQ(n1, queues_get_head_waiting());
+        queues_notification_close(n1, REASON_UNDEF);
+        ASSERT_EQ(NULL, queues_get_head_waiting());
+
+        queues_teardown();
+        PASS();
+}
+
 TEST test_queue_init(void)
 {
         queues_init();
@@ -258,6 +347,12 @@ TEST test_queue_teardown(void)
         ASSERT(waiting == NULL);
         ASSERT(displayed == NULL);
         ASSERT(history == NULL);
+        ASSERT(ids == NULL);
+        ASSERT(stack_tags == NULL);
+        ASSERT(fingerprints == NULL);
+        ASSERT(timers == NULL);
+        ASSERT(expiries == NULL);
+        ASSERT(ticks == NULL);
 
         PASS();
 }
@@ -267,7 +362,7 @@ TEST test_datachange_beginning_empty(void)
         queues_init();
 
         ASSERTm("There are no notifications at all, the timeout has to be less than 0.",
-                queues_get_next_datachange(time_monotonic_now()) < 0);
+                queues_get_next_datachange(time_monotonic_now(), STATUS_NORMAL) < 0);
 
         queues_teardown();
         PASS();
@@ -282,10 +377,10 @@ TEST test_datachange_endless(void)
         struct notification *n = test_notification("n", 0);
 
         queues_notification_insert(n);
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
 
         ASSERTm("Age threshold is deactivated and the notification is infinite, there is no wakeup necessary.",
-                queues_get_next_datachange(time_monotonic_now()) < 0);
+                queues_get_next_datachange(time_monotonic_now(), STATUS_NORMAL) < 0);
 
         queues_teardown();
         PASS();
@@ -300,17 +395,17 @@ TEST test_datachange_endless_agethreshold(void)
         struct notification *n = test_notification("n", 0);
 
         queues_notification_insert(n);
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
 
         ASSERT_IN_RANGEm("Age threshold is activated and the next wakeup should be less than a second away",
-                S2US(1)/2, queues_get_next_datachange(time_monotonic_now() + S2US(4)), S2US(1)/2);
+                S2US(1)/2, queues_get_next_datachange(time_monotonic_now() + S2US(4), STATUS_NORMAL), S2US(1)/2);
 
         ASSERT_IN_RANGEm("Age threshold is activated and the next wakeup should be less than the age threshold",
-                settings.show_age_threshold/2, queues_get_next_datachange(time_monotonic_now()), settings.show_age_threshold/2);
+                settings.show_age_threshold/2, queues_get_next_datachange(time_monotonic_now(), STATUS_NORMAL), settings.show_age_threshold/2);
 
         settings.show_age_threshold = S2US(0);
         ASSERT_IN_RANGEm("Age threshold is activated and the next wakeup should be less than a second away",
-                S2US(1)/2, queues_get_next_datachange(time_monotonic_now()), S2US(1)/2);
+                S2US(1)/2, queues_get_next_datachange(time_monotonic_now(), STATUS_NORMAL), S2US(1)/2);
 
         queues_teardown();
         PASS();
@@ -324,15 +419,15 @@ TEST test_datachange_queues(void)
 
         queues_notification_insert(n);
         ASSERTm("The inserted notification is inside the waiting queue, so it should get ignored.",
-               queues_get_next_datachange(time_monotonic_now()) < S2US(0));
+               queues_get_next_datachange(time_monotonic_now(), STATUS_NORMAL) < S2US(0));
 
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         ASSERT_IN_RANGEm("The notification has to get closed in less than its timeout",
-               S2US(10)/2, queues_get_next_datachange(time_monotonic_now()), S2US(10)/2);
+               S2US(10)/2, queues_get_next_datachange(time_monotonic_now(), STATUS_NORMAL), S2US(10)/2);
 
         queues_notification_close(n, REASON_UNDEF);
         ASSERTm("The inserted notification is inside the history queue, so it should get ignored",
-               queues_get_next_datachange(time_monotonic_now()) < S2US(0));
+               queues_get_next_datachange(time_monotonic_now(), STATUS_NORMAL) < S2US(0));
 
         queues_teardown();
         PASS();
@@ -346,19 +441,19 @@ TEST test_datachange_ttl(void)
         n = test_notification("n1", 15);
 
         queues_notification_insert(n);
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         ASSERT_IN_RANGEm("The notification has to get closed in less than its timeout.",
-               n->timeout/2, queues_get_next_datachange(time_monotonic_now()), n->timeout/2);
+               n->timeout/2, queues_get_next_datachange(time_monotonic_now(), STATUS_NORMAL), n->timeout/2);
 
         n = test_notification("n2", 10);
 
         queues_notification_insert(n);
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         ASSERT_IN_RANGEm("The timeout of the second notification has to get used as sleep time now.",
-               n->timeout/2, queues_get_next_datachange(time_monotonic_now()), n->timeout/2);
+               n->timeout/2, queues_get_next_datachange(time_monotonic_now(), STATUS_NORMAL), n->timeout/2);
 
         ASSERT_EQm("The notification already timed out. You have to answer with 0.",
-               S2US(0), queues_get_next_datachange(time_monotonic_now() + S2US(10)));
+               S2US(0), queues_get_next_datachange(time_monotonic_now() + S2US(10), STATUS_NORMAL));
 
         queues_teardown();
         PASS();
@@ -383,7 +478,7 @@ TEST test_queue_stacking(void)
         NOT_LAST(n1);
 
         notification_ref(n2);
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         queues_notification_insert(n3);
         QUEUE_LEN_ALL(0, 1, 0);
         NOT_LAST(n2);
@@ -414,7 +509,7 @@ TEST test_queue_stacktag(void)
         NOT_LAST(n1);
 
         notification_ref(n2);
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         queues_notification_insert(n3);
         QUEUE_LEN_ALL(0, 1, 0);
         NOT_LAST(n2);
@@ -423,6 +518,25 @@ TEST test_queue_stacktag(void)
         PASS();
 }
 
+TEST test_queue_stacktag_distinct(void)
+{
+        struct notification *n1, *n2;
+
+        queues_init();
+
+        n1 = test_notification("n1", 1);
+        n2 = test_notification("n2", 1);
+        n1->stack_tag = g_strdup("first tag");
+        n2->stack_tag = g_strdup("second tag");
+
+        queues_notification_insert(n1);
+        queues_notification_insert(n2);
+        QUEUE_LEN_ALL(2, 0, 0);
+
+        queues_teardown();
+        PASS();
+}
+
 TEST test_queue_timeout(void)
 {
         settings.geometry.h = 5;
@@ -439,21 +553,17 @@ TEST test_queue_timeout(void)
         queues_notification_insert(n2);
         queues_notification_insert(n3);
 
-        queues_update(STATUS_NORMAL);
+        gint64 now = time_monotonic_now();
+        queues_update(STATUS_NORMAL, now);
 
-        // hacky way to shift time
-        n1->start -= S2US(11);
-        n2->start -= S2US(11);
-        n3->start -= S2US(11);
-        queues_update(STATUS_IDLE);
+        now += S2US(11);
+        queues_update(STATUS_IDLE, now);
 
         QUEUE_LEN_ALL(0,2,1);
         QUEUE_CONTAINS(HIST, n3);
 
-        // hacky way to shift time
-        n1->start -= S2US(11);
-        n2->start -= S2US(11);
-        queues_update(STATUS_NORMAL);
+        now += S2US(11);
+        queues_update(STATUS_NORMAL, now);
 
         QUEUE_LEN_ALL(0,1,2);
         QUEUE_CONTAINS(DISP, n1);
@@ -482,17 +592,17 @@ TEST test_queues_update_fullscreen(void)
         queues_notification_insert(n_dela);
         queues_notification_insert(n_push);
 
-        queues_update(STATUS_FS);
+        queues_update(STATUS_FS, time_monotonic_now());
         QUEUE_CONTAINS(DISP, n_show);
         QUEUE_CONTAINS(WAIT, n_dela);
         QUEUE_CONTAINS(WAIT, n_push);
 
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         QUEUE_CONTAINS(DISP, n_show);
         QUEUE_CONTAINS(DISP, n_dela);
         QUEUE_CONTAINS(DISP, n_push);
 
-        queues_update(STATUS_FS);
+        queues_update(STATUS_FS, time_monotonic_now());
         QUEUE_CONTAINS(DISP, n_show);
         QUEUE_CONTAINS(DISP, n_dela);
         QUEUE_CONTAINS(WAIT, n_push);
@@ -517,13 +627,13 @@ TEST test_queues_update_paused(void)
 
         QUEUE_LEN_ALL(3,0,0);
 
-        queues_update(STATUS_PAUSE);
+        queues_update(STATUS_PAUSE, time_monotonic_now());
         QUEUE_LEN_ALL(3,0,0);
 
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         QUEUE_LEN_ALL(0,3,0);
 
-        queues_update(STATUS_PAUSE);
+        queues_update(STATUS_PAUSE, time_monotonic_now());
         QUEUE_LEN_ALL(3,0,0);
 
         queues_teardown();
@@ -563,7 +673,7 @@ TEST test_queues_update_seeping(void)
         queues_notification_insert(nl5);
 
         QUEUE_LEN_ALL(5,0,0);
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         QUEUE_LEN_ALL(0,5,0);
 
         queues_notification_insert(nc1);
@@ -573,7 +683,7 @@ TEST test_queues_update_seeping(void)
         queues_notification_insert(nc5);
 
         QUEUE_LEN_ALL(5,5,0);
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         QUEUE_LEN_ALL(5,5,0);
 
         QUEUE_CONTAINS(DISP, nc1);
@@ -609,15 +719,15 @@ TEST test_queues_update_xmore(void)
         queues_notification_insert(n2);
         queues_notification_insert(n3);
 
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         QUEUE_LEN_ALL(0,3,0);
 
         queues_notification_insert(n4);
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         QUEUE_LEN_ALL(0,4,0);
 
         queues_notification_insert(n5);
-        queues_update(STATUS_NORMAL);
+        queues_update(STATUS_NORMAL, time_monotonic_now());
         QUEUE_LEN_ALL(2,3,0);
 
         queues_teardown();
@@ -644,12 +754,12 @@ TEST test_queues_update_seep_showlowurg(void)
 
         queues_notification_insert(n1);
         queues_notification_insert(n2);
-        queues_update(STATUS_FS);
+        queues_update(STATUS_FS, time_monotonic_now());
         QUEUE_LEN_ALL(2,0,0);
 
         queues_notification_insert(n3);
 
-        queues_update(STATUS_FS);
+        queues_update(STATUS_FS, time_monotonic_now());
 
         QUEUE_LEN_ALL(2,1,0);
         QUEUE_CONTAINS(WAIT, n1);
@@ -660,6 +770,68 @@ TEST test_queues_update_seep_showlowurg(void)
         PASS();
 }
 
+TEST test_queues_update_fullscreen_order(void)
+{
+        // Test, that the notifications eligible during fullscreen
+        // get shown in order, if the head of waiting is held back
+        settings.geometry.h = 2;
+        settings.sort = true;
+        settings.indicate_hidden = false;
+        struct notification *n1, *n2, *n3, *n4;
+        queues_init();
+
+        n1 = test_notification("n1", 0);
+        n2 = test_notification("n2", 0);
+        n3 = test_notification("n3", 0);
+        n4 = test_notification("n4", 0);
+
+        n1->fullscreen = FS_DELAY;
+        n2->fullscreen = FS_SHOW;
+        n3->fullscreen = FS_SHOW;
+        n4->fullscreen = FS_SHOW;
+
+        n1->urgency = URG_CRIT;
+        n2->urgency = URG_LOW;
+
+        queues_notification_insert(n1);
+        queues_notification_insert(n2);
+        queues_notification_insert(n3);
+        queues_notification_insert(n4);
+
+        queues_update(STATUS_FS, time_monotonic_now());
+
+        QUEUE_LEN_ALL(2,2,0);
+        QUEUE_CONTAINS(WAIT, n1);
+        QUEUE_CONTAINS(WAIT, n2);
+        QUEUE_CONTAINS(DISP, n3);
+        QUEUE_CONTAINS(DISP, n4);
+
+        queues_teardown();
+        PASS();
+}
+
+TEST test_queues_update_changed(void)
+{
+        struct notification *n;
+        settings.show_age_threshold = -1;
+        queues_init();
+
+        n = test_notification("n", 10);
+        queues_notification_insert(n);
+
+        gint64 now = time_monotonic_now();
+        ASSERTm("Showing a notification is a change",
+                queues_update(STATUS_NORMAL, now));
+        ASSERT_FALSE(queues_update(STATUS_NORMAL, now + S2US(1)));
+        ASSERTm("The expiry of a notification is a change",
+                queues_update(STATUS_NORMAL, now + S2US(11)));
+        ASSERT_FALSE(queues_update(STATUS_NORMAL, now + S2US(12)));
+        QUEUE_LEN_ALL(0,0,1);
+
+        queues_teardown();
+        PASS();
+}
+
 TEST test_queues_timeout_before_paused(void)
 {
         struct notification *n;
@@ -668,11 +840,33 @@ TEST test_queues_timeout_before_paused(void)
         n = test_notification("n", 10);
 
         queues_notification_insert(n);
-        queues_update(STATUS_NORMAL);
+        gint64 now = time_monotonic_now();
+        queues_update(STATUS_NORMAL, now);
+
+        queues_update(STATUS_PAUSE, now + S2US(11));
+
+        QUEUE_LEN_ALL(0,0,1);
+
+        queues_teardown();
+        PASS();
+}
+
+TEST test_queues_timeout_restart_after_idle(void)
+{
+        struct notification *n;
+        queues_init();
+
+        n = test_notification("n", 10);
+
+        queues_notification_insert(n);
+        gint64 now = time_monotonic_now();
+        queues_update(STATUS_NORMAL, now);
 
-        n->start -= S2US(11);
-        queues_update(STATUS_PAUSE);
+        queues_update(STATUS_IDLE, now + S2US(5));
+        queues_update(STATUS_NORMAL, now + S2US(11));
+        QUEUE_LEN_ALL(0,1,0);
 
+        queues_update(STATUS_NORMAL, now + S2US(16));
         QUEUE_LEN_ALL(0,0,1);
 
         queues_teardown();
@@ -686,6 +880,8 @@ SUITE(suite_queues)
         RUN_TEST(test_datachange_endless_agethreshold);
         RUN_TEST(test_datachange_queues);
         RUN_TEST(test_datachange_ttl);
+        RUN_TEST(test_queue_close_id_after_move);
+        RUN_TEST(test_queue_close_id_shared);
         RUN_TEST(test_queue_history_overfull);
         RUN_TEST(test_queue_history_pushall);
         RUN_TEST(test_queue_init);
@@ -697,14 +893,21 @@ SUITE(suite_queues)
         RUN_TEST(test_queue_notification_close_histignore);
         RUN_TEST(test_queue_stacking);
         RUN_TEST(test_queue_stacktag);
+        RUN_TEST(test_queue_stacktag_distinct);
         RUN_TEST(test_queue_teardown);
+        RUN_TEST(test_queue_waiting_order);
         RUN_TEST(test_queue_timeout);
         RUN_TEST(test_queues_update_fullscreen);
         RUN_TEST(test_queues_update_paused);
         RUN_TEST(test_queues_update_seep_showlowurg);
         RUN_TEST(test_queues_update_seeping);
         RUN_TEST(test_queues_update_xmore);
+        RUN_TEST(test_queues_update_fullscreen_order);
+        RUN_TEST(test_queues_update_changed);
         RUN_TEST(test_queues_timeout_before_paused);
+        RUN_TEST(test_queues_timeout_restart_after_idle);
+
+        notification_format_teardown();
 }
 
 /* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
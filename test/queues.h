@@ -6,6 +6,7 @@
 #include <stdbool.h>
 #include <glib.h>
 
+#include "../src/heap.h"
 #include "../src/notification.h"
 #include "../src/queues.h"
 
@@ -21,16 +22,27 @@
 #define QUEUE(q) QUEUE_##q
 
 #define QUEUE_LEN_ALL(wait, disp, hist) do { \
-        if (wait >= 0) ASSERTm("Waiting is not "   #wait, wait == g_queue_get_length(QUEUE(WAIT))); \
+        if (wait >= 0) ASSERTm("Waiting is not "   #wait, wait == heap_length(QUEUE(WAIT))); \
         if (disp >= 0) ASSERTm("Displayed is not " #disp, disp == g_queue_get_length(QUEUE(DISP))); \
         if (disp >= 0) ASSERTm("History is not "   #hist, hist == g_queue_get_length(QUEUE(HIST))); \
         } while (0)
 
 #define QUEUE_CONTAINS(q, n) QUEUE_CONTAINSm("QUEUE_CONTAINS(" #q "," #n ")", q, n)
-#define QUEUE_CONTAINSm(msg, q, n) ASSERTm(msg, g_queue_find(QUEUE(q), n))
+#define QUEUE_CONTAINSm(msg, q, n) ASSERTm(msg, QUEUE_FIND_##q(n))
+#define QUEUE_FIND_WAIT(n) heap_contains(QUEUE(WAIT), n)
+#define QUEUE_FIND_DISP(n) g_queue_find(QUEUE(DISP), n)
+#define QUEUE_FIND_HIST(n) g_queue_find(QUEUE(HIST), n)
 
 #define NOT_LAST(n) do {ASSERT_EQm("Notification " #n " should have been deleted.", 1, notification_refcount_get(n)); g_clear_pointer(&n, notification_unref); } while(0)
 
+static inline bool heap_contains(const struct heap *h, const void *data)
+{
+        for (unsigned int i = 0; i < heap_length(h); i++)
+                if (heap_nth(h, i)->data == data)
+                        return true;
+        return false;
+}
+
 static inline struct notification *test_notification(const char *name, gint64 timeout)
 {
         struct notification *n = notification_create();
@@ -0,0 +1,365 @@
+#include "../src/rules.c"
+#include "greatest.h"
+
+#include <fnmatch.h>
+
+TEST test_rule_pattern_compile(void)
+{
+        struct rule_pattern p;
+
+        rule_pattern_compile(&p, NULL);
+        ASSERT_EQ(PATTERN_NONE, p.kind);
+
+        rule_pattern_compile(&p, "firefox");
+        ASSERT_EQ(PATTERN_EXACT, p.kind);
+        ASSERT_EQ(7, p.len);
+
+        rule_pattern_compile(&p, "fire*");
+        ASSERT_EQ(PATTERN_PREFIX, p.kind);
+        ASSERT_EQ(4, p.len);
+
+        rule_pattern_compile(&p, "*fox");
+        ASSERT_EQ(PATTERN_SUFFIX, p.kind);
+        ASSERT_EQ(3, p.len);
+
+        rule_pattern_compile(&p, "*ref*");
+        ASSERT_EQ(PATTERN_CONTAINS, p.kind);
+        ASSERT_EQ(3, p.len);
+
+        rule_pattern_compile(&p, "*");
+        ASSERT_EQ(PATTERN_SUFFIX, p.kind);
+        ASSERT_EQ(0, p.len);
+
+        const char *globs[] = { "fire?ox", "f*x", "[Ff]irefox", "fire\\*", "**fox" };
+        for (int i = 0; i < G_N_ELEMENTS(globs); i++) {
+                rule_pattern_compile(&p, globs[i]);
+                ASSERT_EQm(globs[i], PATTERN_GLOB, p.kind);
+        }
+
+        PASS();
+}
+
+TEST test_rule_pattern_matches(void)
+{
+        const char *globs[] = {
+                "", "*", "**", "firefox", "fire*", "*fox", "*ref*", "*x*", "f*x",
+                "fire?ox", "[Ff]irefox", "fire\\*", "firefox*", "*firefox",
+                "*firefox*", "firefoxes",
+        };
+        const char *strs[] = {
+                "", "firefox", "Firefox", "fire*", "firefoxfox", "refire", "fox", "x",
+        };
+
+        for (int i = 0; i < G_N_ELEMENTS(globs); i++) {
+                struct rule_pattern p;
+                rule_pattern_compile(&p, globs[i]);
+                for (int j = 0; j < G_N_ELEMENTS(strs); j++) {
+                        char *msg = g_strdup_printf("'%s' on '%s'", globs[i], strs[j]);
+                        bool expected = !fnmatch(globs[i], strs[j], 0);
+                        if (expected != rule_pattern_matches(&p, strs[j])) {
+                                FAILm(msg);
+                        }
+                        g_free(msg);
+                }
+                ASSERT_FALSE(rule_pattern_matches(&p, NULL));
+        }
+
+        PASS();
+}
+
+TEST test_rule_apply_all_order(void)
+{
+        GSList *saved = rules;
+        struct rule r[4];
+        for (int i = 0; i < G_N_ELEMENTS(r); i++)
+                rule_init(&r[i]);
+
+        // indexed by appname, by category and unindexed, interleaved
+        r[0].appname = "app";
+        r[0].timeout = 1;
+        r[1].summary = "*";
+        r[1].timeout = 2;
+        r[2].category = "cat";
+        r[2].timeout = 3;
+        r[3].appname = "other";
+        r[3].timeout = 4;
+
+        rules = NULL;
+        for (int i = 0; i < G_N_ELEMENTS(r); i++)
+                rules = g_slist_append(rules, &r[i]);
+        rules_compile();
+
+        struct notification *n = notification_create();
+        n->appname = g_strdup("app");
+        n->summary = g_strdup("summary");
+
+        rule_apply_all(n);
+        ASSERT_EQ(2, n->timeout);
+
+        n->category = g_strdup("cat");
+        rule_apply_all(n);
+        ASSERT_EQ(3, n->timeout);
+
+        g_free(n->appname);
+        n->appname = g_strdup("other");
+        rule_apply_all(n);
+        ASSERT_EQ(4, n->timeout);
+
+        notification_unref(n);
+        g_slist_free(rules);
+        rules = saved;
+        rules_compile();
+
+        PASS();
+}
+
+TEST test_rule_cache(void)
+{
+        GSList *saved = rules;
+        struct rule r[4];
+        for (int i = 0; i < G_N_ELEMENTS(r); i++)
+                rule_init(&r[i]);
+
+        r[0].appname = "app";
+        r[0].timeout = 1;
+        // only evaluated, it changes nothing later rules inspect
+        r[1].summary = "*error*";
+        r[1].timeout = 2;
+        r[1].new_icon = "error";
+        // changes the urgency, which the last rule inspects
+        r[2].body = "*critical*";
+        r[2].urgency = URG_CRIT;
+        r[3].msg_urgency = URG_CRIT;
+        r[3].set_stack_tag = "critical";
+
+        rules = NULL;
+        for (int i = 0; i < G_N_ELEMENTS(r); i++)
+                rules = g_slist_append(rules, &r[i]);
+        rules_compile();
+
+        ASSERT_EQ(RULE_CACHE_RESULT, rule_index.cacheable[0]);
+        ASSERT_EQ(RULE_CACHE_EVAL, rule_index.cacheable[1]);
+        ASSERT_EQ(RULE_CACHE_STOP, rule_index.cacheable[2]);
+        ASSERT_EQ(RULE_CACHE_RESULT, rule_index.cacheable[3]);
+
+        const char *summaries[] = { "all fine", "an error", "all fine", "an error" };
+        const char *bodies[] = { "body", "body", "critical body", "body" };
+        for (int i = 0; i < G_N_ELEMENTS(summaries); i++) {
+                struct notification *n = notification_create();
+                n->appname = g_strdup("app");
+                n->summary = g_strdup(summaries[i]);
+                n->body = g_strdup(bodies[i]);
+                n->urgency = URG_NORM;
+
+                rule_apply_all(n);
+                ASSERT_EQ(i % 2 ? 2 : 1, n->timeout);
+                ASSERT_EQ(0, g_strcmp0(i % 2 ? "error" : NULL, n->icon));
+                ASSERT_EQ(i == 2 ? URG_CRIT : URG_NORM, n->urgency);
+                ASSERT_EQ(0, g_strcmp0(i == 2 ? "critical" : NULL, n->stack_tag));
+
+                notification_unref(n);
+        }
+        ASSERT_EQ(3, rule_cache.hits);
+        ASSERT_EQ(1, rule_cache.misses);
+
+        g_slist_free(rules);
+        rules = saved;
+        rules_compile();
+
+        PASS();
+}
+
+TEST test_rule_regex(void)
+{
+        struct rule r;
+        rule_init(&r);
+        struct notification *n = notification_create();
+        n->appname = g_strdup("firefox");
+        n->body = g_strdup("Download 42 finished");
+
+        r.body_regex = "^Download [0-9]+ ";
+        ASSERT(rule_matches_notification(&r, n));
+
+        // both the glob and the regex have to match
+        r.appname = "chromium";
+        rule_compile(&r);
+        ASSERT_FALSE(rule_matches_notification(&r, n));
+        r.appname = "fire*";
+        r.appname_regex = "fox$";
+        rule_compile(&r);
+        ASSERT(rule_matches_notification(&r, n));
+        r.appname_regex = "^fox";
+        rule_compile(&r);
+        ASSERT_FALSE(rule_matches_notification(&r, n));
+
+        // a missing field never matches
+        r.appname_regex = NULL;
+        r.category_regex = ".*";
+        rule_compile(&r);
+        ASSERT_FALSE(rule_matches_notification(&r, n));
+
+        // neither does an invalid regex
+        r.category_regex = NULL;
+        r.summary_regex = "(unclosed";
+        rule_compile(&r);
+        ASSERT(r.invalid);
+        ASSERT_FALSE(rule_matches_notification(&r, n));
+
+        r.summary_regex = NULL;
+        rule_compile(&r);
+        ASSERT_FALSE(r.invalid);
+        ASSERT(rule_matches_notification(&r, n));
+
+        for (int i = 0; i < RULE_FIELD_COUNT; i++)
+                g_clear_pointer(&r.regexes[i], g_regex_unref);
+        notification_unref(n);
+        PASS();
+}
+
+TEST test_rule_regex_is_combinable(void)
+{
+        ASSERT(rule_regex_is_combinable("^Build [0-9]+ failed$"));
+        ASSERT(rule_regex_is_combinable("(?i)error|warning"));
+        ASSERT(rule_regex_is_combinable("(a)(b)"));
+        ASSERT(rule_regex_is_combinable("\\\\"));
+        ASSERT_FALSE(rule_regex_is_combinable("(a)\\1"));
+        ASSERT_FALSE(rule_regex_is_combinable("(a)\\g{1}"));
+        ASSERT_FALSE(rule_regex_is_combinable("a(?1)?"));
+        ASSERT_FALSE(rule_regex_is_combinable("a(?R)?"));
+        ASSERT_FALSE(rule_regex_is_combinable("\\Qa"));
+        ASSERT_FALSE(rule_regex_is_combinable("(?x)a#"));
+        PASS();
+}
+
+TEST test_rule_combined_body_regexes(void)
+{
+        GSList *saved = rules;
+        bool saved_combine = settings.combine_body_regexes;
+        struct rule r[4];
+        for (int i = 0; i < G_N_ELEMENTS(r); i++)
+                rule_init(&r[i]);
+
+        r[0].body_regex = "err(or)?";
+        r[0].timeout = 1;
+        // overlaps the first alternative at the same position
+        r[1].body_regex = "error: [a-z]+";
+        r[1].history_ignore = 1;
+        // can't be combined
+        r[2].body_regex = "(x)\\1";
+        r[2].urgency = URG_CRIT;
+        r[3].body_regex = "^done$";
+        r[3].timeout = 4;
+
+        settings.combine_body_regexes = true;
+        rules = NULL;
+        for (int i = 0; i < G_N_ELEMENTS(r); i++)
+                rules = g_slist_append(rules, &r[i]);
+        rules_compile();
+
+        ASSERT(rule_index.body_regex);
+        ASSERT(r[0].body_regex_combined);
+        ASSERT(r[1].body_regex_combined);
+        ASSERT_FALSE(r[2].body_regex_combined);
+        ASSERT(r[3].body_regex_combined);
+
+        const char *bodies[] = { "fine", "error: disk", "xx", "done", "err xx" };
+        gint64 timeouts[] = { -1, 1, -1, 4, 1 };
+        int ignored[] = { 0, 1, 0, 0, 0 };
+        enum urgency urgencies[] = { URG_NORM, URG_NORM, URG_CRIT, URG_NORM, URG_CRIT };
+        for (int i = 0; i < G_N_ELEMENTS(bodies); i++) {
+                struct notification *n = notification_create();
+                n->body = g_strdup(bodies[i]);
+                n->timeout = -1;
+                n->urgency = URG_NORM;
+
+                rule_apply_all(n);
+                ASSERT_EQm(bodies[i], timeouts[i], n->timeout);
+                ASSERT_EQm(bodies[i], ignored[i], n->history_ignore);
+                ASSERT_EQm(bodies[i], urgencies[i], n->urgency);
+                ASSERT_EQ(NULL, body_scan.n);
+
+                notification_unref(n);
+        }
+
+        g_slist_free(rules);
+        for (int i = 0; i < G_N_ELEMENTS(r); i++)
+                for (int j = 0; j < RULE_FIELD_COUNT; j++)
+                        g_clear_pointer(&r[i].regexes[j], g_regex_unref);
+        rules = saved;
+        settings.combine_body_regexes = saved_combine;
+        rules_compile();
+
+        PASS();
+}
+
+TEST test_rule_stats(void)
+{
+        GSList *saved = rules;
+        bool saved_profile = settings.profile_rules;
+        struct rule_stats before = rules_get_stats();
+        struct rule r[2];
+        for (int i = 0; i < G_N_ELEMENTS(r); i++)
+                rule_init(&r[i]);
+
+        r[0].appname = "app";
+        r[0].timeout = 1;
+        r[1].summary = "*error*";
+        r[1].timeout = 2;
+
+        settings.profile_rules = true;
+        rules = NULL;
+        for (int i = 0; i < G_N_ELEMENTS(r); i++)
+                rules = g_slist_append(rules, &r[i]);
+        rules_compile();
+
+        const char *summaries[] = { "an error", "all fine", "another error" };
+        for (int i = 0; i < G_N_ELEMENTS(summaries); i++) {
+                struct notification *n = notification_create();
+                n->appname = g_strdup("app");
+                n->summary = g_strdup(summaries[i]);
+                rule_apply_all(n);
+                notification_unref(n);
+        }
+
+        // the result of the first rule got cached after the first notification
+        ASSERT_EQ(1, r[0].stats.evaluations);
+        ASSERT_EQ(3, r[0].stats.matches);
+        ASSERT_EQ(3, r[1].stats.evaluations);
+        ASSERT_EQ(2, r[1].stats.matches);
+
+        struct rule_stats total = rules_get_stats();
+        ASSERT_EQ(3, total.evaluations - before.evaluations);
+        ASSERT_EQ(5, total.matches - before.matches);
+        ASSERT(total.time >= r[0].stats.time + r[1].stats.time);
+
+        // nothing gets counted without profiling
+        settings.profile_rules = false;
+        struct notification *n = notification_create();
+        n->appname = g_strdup("app");
+        rule_apply_all(n);
+        notification_unref(n);
+        ASSERT_EQ(1, r[0].stats.evaluations);
+        ASSERT_EQ(3, r[0].stats.matches);
+        ASSERT_EQ(3, rules_get_stats().evaluations - before.evaluations);
+
+        g_slist_free(rules);
+        rules = saved;
+        settings.profile_rules = saved_profile;
+        rules_compile();
+
+        PASS();
+}
+
+SUITE(suite_rules)
+{
+        RUN_TEST(test_rule_pattern_compile);
+        RUN_TEST(test_rule_pattern_matches);
+        RUN_TEST(test_rule_apply_all_order);
+        RUN_TEST(test_rule_cache);
+        RUN_TEST(test_rule_regex);
+        RUN_TEST(test_rule_regex_is_combinable);
+        RUN_TEST(test_rule_combined_body_regexes);
+        RUN_TEST(test_rule_stats);
+}
+
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
@@ -13,11 +13,15 @@ SUITE_EXTERN(suite_utils);
 SUITE_EXTERN(suite_option_parser);
 SUITE_EXTERN(suite_notification);
 SUITE_EXTERN(suite_markup);
+SUITE_EXTERN(suite_menu);
 SUITE_EXTERN(suite_misc);
 SUITE_EXTERN(suite_icon);
 SUITE_EXTERN(suite_queues);
+SUITE_EXTERN(suite_rules);
+SUITE_EXTERN(suite_heap);
 SUITE_EXTERN(suite_dunst);
 SUITE_EXTERN(suite_log);
+SUITE_EXTERN(suite_x);
 
 GREATEST_MAIN_DEFS();
 
@@ -37,11 +41,15 @@ int main(int argc, char *argv[]) {
         RUN_SUITE(suite_option_parser);
         RUN_SUITE(suite_notification);
         RUN_SUITE(suite_markup);
+        RUN_SUITE(suite_menu);
         RUN_SUITE(suite_misc);
         RUN_SUITE(suite_icon);
         RUN_SUITE(suite_queues);
+        RUN_SUITE(suite_rules);
+        RUN_SUITE(suite_heap);
         RUN_SUITE(suite_dunst);
         RUN_SUITE(suite_log);
+        RUN_SUITE(suite_x);
         GREATEST_MAIN_END();
 
         base = NULL;
@@ -175,6 +175,34 @@ TEST test_string_to_time(void)
         PASS();
 }
 
+TEST test_string_intern(void)
+{
+        guint count = string_interned_count();
+        char *buf = g_strdup("interned");
+
+        char *a = string_intern(buf);
+        char *b = string_intern("interned");
+        ASSERT(a != buf);
+        ASSERT_EQ(a, b);
+        ASSERT_STR_EQ("interned", a);
+        ASSERT_EQ(count + 1, string_interned_count());
+        ASSERT_EQ(NULL, string_intern(NULL));
+
+        // an equal string, which isn't interned, just gets freed
+        string_release(buf);
+        ASSERT_EQ(count + 1, string_interned_count());
+
+        string_release(a);
+        ASSERT_EQ(count + 1, string_interned_count());
+        ASSERT_STR_EQ("interned", b);
+        string_release(b);
+        ASSERT_EQ(count, string_interned_count());
+
+        string_release(NULL);
+
+        PASS();
+}
+
 SUITE(suite_utils)
 {
         RUN_TEST(test_string_replace_char);
@@ -184,5 +212,6 @@ SUITE(suite_utils)
         RUN_TEST(test_string_strip_delimited);
         RUN_TEST(test_string_to_path);
         RUN_TEST(test_string_to_time);
+        RUN_TEST(test_string_intern);
 }
 /* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */
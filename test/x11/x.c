@@ -0,0 +1,185 @@
+#include "../../src/x11/x.c"
+#include "../greatest.h"
+
+#define WIDTH_TEST 32
+#define HEIGHT_TEST 16
+
+#define RED   0xff0000UL
+#define GREEN 0x00ff00UL
+#define BLUE  0x0000ffUL
+
+static const struct dimensions dim_test = { 0, 0, WIDTH_TEST, HEIGHT_TEST, 0 };
+
+/* A mapped window without a GSource, so it doesn't need x_setup() */
+static struct window_x11 *test_win_create(void)
+{
+        struct window_x11 *win = g_malloc0(sizeof(struct window_x11));
+        int scr = DefaultScreen(xctx.dpy);
+        XSetWindowAttributes wa = { .override_redirect = true };
+
+        win->xwin = XCreateWindow(xctx.dpy, RootWindow(xctx.dpy, scr),
+                                  0, 0, WIDTH_TEST, HEIGHT_TEST, 0,
+                                  DefaultDepth(xctx.dpy, scr), CopyFromParent,
+                                  DefaultVisual(xctx.dpy, scr),
+                                  CWOverrideRedirect, &wa);
+        win->root_surface = cairo_xlib_surface_create(xctx.dpy, win->xwin,
+                                                      DefaultVisual(xctx.dpy, scr),
+                                                      WIDTH_TEST, HEIGHT_TEST);
+        win->c_ctx = cairo_create(win->root_surface);
+        win->gc = XCreateGC(xctx.dpy, win->xwin, 0, NULL);
+        win->dim = dim_test;
+
+        XMapRaised(xctx.dpy, win->xwin);
+        XSync(xctx.dpy, false);
+
+        return win;
+}
+
+static void test_win_destroy(struct window_x11 *win)
+{
+        for (int i = 0; i < G_N_ELEMENTS(win->shm); i++)
+                g_clear_pointer(&win->shm[i], shm_buffer_free);
+
+        cairo_destroy(win->c_ctx);
+        cairo_surface_destroy(win->root_surface);
+        XFreeGC(xctx.dpy, win->gc);
+        XDestroyWindow(xctx.dpy, win->xwin);
+        XSync(xctx.dpy, false);
+
+        g_free(win);
+}
+
+static void test_surface_fill(cairo_surface_t *srf, unsigned long rgb)
+{
+        cairo_t *c = cairo_create(srf);
+        cairo_set_source_rgb(c, (rgb >> 16 & 0xff) / 255.0,
+                                (rgb >>  8 & 0xff) / 255.0,
+                                (rgb       & 0xff) / 255.0);
+        cairo_paint(c);
+        cairo_destroy(c);
+}
+
+static unsigned long test_win_pixel(struct window_x11 *win, int x, int y)
+{
+        XImage *img = XGetImage(xctx.dpy, win->xwin, x, y, 1, 1, AllPlanes, ZPixmap);
+        unsigned long pixel = XGetPixel(img, 0, 0) & 0xffffff;
+        XDestroyImage(img);
+        return pixel;
+}
+
+/*
+ * Present the surface in a new color, but only the damaged rectangle of it.
+ * The rest of the window has to keep the old color.
+ */
+static enum greatest_test_res test_present_damage(struct window_x11 *win,
+                                                  cairo_surface_t *srf,
+                                                  unsigned long old,
+                                                  unsigned long new)
+{
+        cairo_rectangle_int_t rect = { 4, 4, 8, 8 };
+        cairo_region_t *damage = cairo_region_create_rectangle(&rect);
+
+        test_surface_fill(srf, new);
+        x_display_surface(srf, win, &dim_test, damage);
+        cairo_region_destroy(damage);
+
+        ASSERT_EQ_FMT(new, test_win_pixel(win, 4, 4), "%06lx");
+        ASSERT_EQ_FMT(new, test_win_pixel(win, 11, 11), "%06lx");
+        ASSERT_EQ_FMT(old, test_win_pixel(win, 3, 4), "%06lx");
+        ASSERT_EQ_FMT(old, test_win_pixel(win, 12, 11), "%06lx");
+        ASSERT_EQ_FMT(old, test_win_pixel(win, WIDTH_TEST - 1, HEIGHT_TEST - 1), "%06lx");
+
+        PASS();
+}
+
+TEST test_x_display_surface_xlib(void)
+{
+        if (!xctx.dpy)
+                SKIPm("Cannot open X11 display.");
+
+        bool shm = xctx.shm;
+        xctx.shm = false;
+        settings.corner_radius = 0;
+
+        struct window_x11 *win = test_win_create();
+        cairo_surface_t *srf = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+                                                          WIDTH_TEST, HEIGHT_TEST);
+        test_surface_fill(srf, RED);
+        x_display_surface(srf, win, &dim_test, NULL);
+        ASSERT_EQ_FMT(RED, test_win_pixel(win, 0, 0), "%06lx");
+
+        CHECK_CALL(test_present_damage(win, srf, RED, BLUE));
+        ASSERT_EQ(NULL, win->shm[0]);
+
+        cairo_surface_destroy(srf);
+        test_win_destroy(win);
+        xctx.shm = shm;
+        PASS();
+}
+
+TEST test_x_display_surface_shm(void)
+{
+        if (!xctx.dpy)
+                SKIPm("Cannot open X11 display.");
+        if (!XShmQueryExtension(xctx.dpy))
+                SKIPm("The X server doesn't support MIT-SHM.");
+
+        xctx.shm = true;
+        xctx.shm_completion = XShmGetEventBase(xctx.dpy) + ShmCompletion;
+        settings.corner_radius = 0;
+
+        struct window_x11 *win = test_win_create();
+        cairo_surface_t *srf = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+                                                          WIDTH_TEST, HEIGHT_TEST);
+        test_surface_fill(srf, RED);
+        x_display_surface(srf, win, &dim_test, NULL);
+        if (!xctx.shm) {
+                cairo_surface_destroy(srf);
+                test_win_destroy(win);
+                SKIPm("The X server can't access our shared memory.");
+        }
+        ASSERT(win->shm[0]);
+        ASSERT_EQ_FMT(RED, test_win_pixel(win, 0, 0), "%06lx");
+
+        /* The first buffer is still busy, as nobody processed the
+         * completion event yet */
+        CHECK_CALL(test_present_damage(win, srf, RED, BLUE));
+        ASSERT(win->shm[1]);
+        ASSERT(win->shm[0]->pending > 0);
+        ASSERT(win->shm[1]->pending > 0);
+
+        /* Both buffers are busy, so the xlib path has to take over */
+        CHECK_CALL(test_present_damage(win, srf, RED, GREEN));
+
+        XEvent ev;
+        XSync(xctx.dpy, false);
+        while (XCheckTypedEvent(xctx.dpy, xctx.shm_completion, &ev))
+                ASSERT(x_shm_check_event(&ev));
+        ASSERT_EQ(0, win->shm[0]->pending);
+        ASSERT_EQ(0, win->shm[1]->pending);
+
+        /* The buffers got free again */
+        struct shm_buffer *buf = win->shm[0];
+        CHECK_CALL(test_present_damage(win, srf, RED, BLUE));
+        ASSERT_EQ(buf, win->shm[0]);
+        ASSERT(win->shm[0]->pending > 0);
+
+        cairo_surface_destroy(srf);
+        test_win_destroy(win);
+        ASSERT_EQ(NULL, shm_buffers);
+        PASS();
+}
+
+SUITE(suite_x)
+{
+        xctx.dpy = XOpenDisplay(NULL);
+
+        RUN_TEST(test_x_display_surface_xlib);
+        RUN_TEST(test_x_display_surface_shm);
+
+        if (xctx.dpy)
+                XCloseDisplay(xctx.dpy);
+        xctx = (struct x_context) { 0 };
+}
+
+/* vim: set tabstop=8 shiftwidth=8 expandtab textwidth=0: */